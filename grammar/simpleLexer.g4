@@ -10,9 +10,12 @@ LPAREN : '(' ;
 RPAREN : ')' ;
 LBRAC : '{' ;
 RBRAC : '}' ;
+COMMA : ',' ;
 WHILE: 'while';
 IF: 'if';
 ELSE: 'else';
+FUNC: 'func';
+RETURN: 'return';
 
 fragment INT : [0] | [1-9][0-9]* ;
 NUM : INT;
@@ -2,7 +2,13 @@ parser grammar simpleParser;
 options { tokenVocab=simpleLexer; }
 
 program
-    : stat+ EOF
+    : (func | stat)+ EOF
+    ;
+
+func: FUNC ID LPAREN params? RPAREN LBRAC stat_list RBRAC
+    ;
+
+params: ID (COMMA ID)*
     ;
 
 stat_list: stat+
@@ -11,6 +17,7 @@ stat_list: stat+
 stat: vardecl
     | if
     | while
+    | return
     ;
 
 vardecl: ID '=' expr
@@ -18,6 +25,7 @@ vardecl: ID '=' expr
 
 expr: ID
     | NUM
+    | ID LPAREN args? RPAREN
     | LPAREN expr RPAREN
     | expr PLUS expr
     | expr MINUS expr
@@ -25,6 +33,12 @@ expr: ID
     | expr LT expr
     ;
 
+args: expr (COMMA expr)*
+    ;
+
+return: RETURN expr
+    ;
+
 while: WHILE LPAREN expr RPAREN LBRAC stat_list RBRAC
      ;
 
@@ -31,6 +31,18 @@ std::string AstNode::toString() const{
             return "STAT_LIST";
         case NodeType::VARDECL:
             return children.at(0)->toString() + " = " + children.at(1)->toString();
+        case NodeType::RETURN:
+            return value + " " + children.at(0)->toString();
+        case NodeType::CALL:
+        case NodeType::FUNC:{
+            // call arguments, or the parameters ahead of a function's body
+            std::string str = (type == NodeType::FUNC ? "func " : "") + value + "(";
+            for(int i = 0; i < children.size(); ++i){
+                if(children[i]->type == NodeType::STAT_LIST) {break;}
+                str += (i ? ", " : "") + children[i]->toString();
+            }
+            return str + ")";
+        }
         default:
             return "UNKWN";
     }
@@ -62,6 +74,12 @@ std::string nodetype2str(NodeType type){
             return "VARDECL";
         case NodeType::WHILE:
             return "WHILE";
+        case NodeType::FUNC:
+            return "FUNC";
+        case NodeType::CALL:
+            return "CALL";
+        case NodeType::RETURN:
+            return "RETURN";
         default:
             return "UNKWN";
     }
@@ -98,6 +116,23 @@ void SimpleAst::exitExpr(simpleParser::ExprContext *ctx){
         stack_machine.push(tempNode);
         return;
     }
+    if(ctx->LPAREN() && ctx->ID()){
+        // call, the arguments are on the stack in order
+        tempNode->type = NodeType::CALL;
+        tempNode->value = ctx->ID()->getText();
+        int argCount = ctx->args() ? ctx->args()->expr().size() : 0;
+        for(int i = 0; i < argCount; ++i){
+            tempNode->adopt_child_r(stack_machine.top());
+            stack_machine.pop();
+        }
+        stack_machine.push(tempNode);
+        return;
+    }
+    if(ctx->LPAREN()){
+        // parenthesized, the inner expression is already on the stack
+        delete tempNode;
+        return;
+    }
     // we have an operation expression
     // adopt two items from the stack
     tempNode->adopt_child_r(stack_machine.top());
@@ -193,4 +228,33 @@ void SimpleAst::exitProgram(simpleParser::ProgramContext *ctx){
         stack_machine.pop();
     }
     
-}
\ No newline at end of file
+}
+
+void SimpleAst::enterFunc(simpleParser::FuncContext *ctx){
+    // pushed first so the body's stat_list stops at it
+    AstNode* tempNode = new AstNode(ctx->ID()->getText(), NodeType::FUNC);
+    if(ctx->params()){
+        for(auto* param : ctx->params()->ID()){
+            tempNode->adopt_child(new AstNode(param->getText(), NodeType::VAR));
+        }
+    }
+    stack_machine.push(tempNode);
+}
+
+void SimpleAst::exitFunc(simpleParser::FuncContext *ctx){
+    // children: params..., body
+    AstNode* body = stack_machine.top();
+    stack_machine.pop();
+    assert(body->type == NodeType::STAT_LIST);
+    assert(stack_machine.top()->type == NodeType::FUNC);
+    stack_machine.top()->adopt_child(body);
+}
+
+void SimpleAst::exitReturn(simpleParser::ReturnContext *ctx){
+    // children: value
+    AstNode* tempNode = new AstNode("return", NodeType::RETURN);
+    tempNode->isStatment = true;
+    tempNode->adopt_child(stack_machine.top());
+    stack_machine.pop();
+    stack_machine.push(tempNode);
+}
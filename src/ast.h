@@ -15,7 +15,10 @@ enum NodeType{
     VAR,
     NUM,
     OP,
-    CMPOP
+    CMPOP,
+    FUNC,
+    CALL,
+    RETURN
 };
 
 using namespace antlrcpp;
@@ -52,6 +55,9 @@ class SimpleAst: public simpleParserBaseListener
         void exitVardecl(simpleParser::VardeclContext *ctx);
         void exitIf(simpleParser::IfContext *ctx);
         void exitWhile(simpleParser::WhileContext *ctx);
+        void enterFunc(simpleParser::FuncContext *ctx);
+        void exitFunc(simpleParser::FuncContext *ctx);
+        void exitReturn(simpleParser::ReturnContext *ctx);
         void exitProgram(simpleParser::ProgramContext *ctx);
 
 };
@@ -1,54 +1,67 @@
 #include "cfg.h"
 #include <vector>
+#include <algorithm>
 
 
-void CFGNode::insertChild(CFGNode* node){
-    if(std::find(children.begin(), children.end(), node) == children.end()){
-        children.push_back(node);
-    }
+int CFGCreator::registerCFGBlock(AstNode* node, std::vector<int> parents){
+    blockNodes.push_back(node);
+    blockParents.push_back(parents);
+    return blockNodes.size() - 1;
 }
 
-void CFGNode::insertParent(CFGNode* node){
-    if(std::find(parents.begin(), parents.end(), node) == parents.end()){
-        parents.push_back(node);
-    }
-}
-
-void CFGCreator::registerCFGBlock(CFGNode* node){
-    cfgBlocks[rid] = node;
-    rid += 1;
-}
-void CFGCreator::resolveChildren(){
-    for(auto elem : cfgBlocks){
-        for(auto parent : elem.second->parents){
-            parent->insertChild(elem.second);
+void CFGCreator::freeze(){
+    int count = blockNodes.size();
+    compactCFG = CompactCFG();
+    compactCFG.blocks.resize(count);
+    // an if without else and an empty body both list the same parent twice
+    std::vector<std::vector<int>> children(count);
+    for(int id = 0; id < count; ++id){
+        compactCFG.blocks[id].astNode = blockNodes[id];
+        auto& parents = blockParents[id];
+        std::sort(parents.begin(), parents.end());
+        parents.erase(std::unique(parents.begin(), parents.end()), parents.end());
+        for(auto parent : parents){
+            children[parent].push_back(id);
         }
     }
+    compactCFG.succOffsets.reserve(count + 1);
+    compactCFG.predOffsets.reserve(count + 1);
+    for(int id = 0; id < count; ++id){
+        compactCFG.succOffsets.push_back(compactCFG.succs.size());
+        compactCFG.succs.insert(compactCFG.succs.end(), children[id].begin(), children[id].end());
+        compactCFG.predOffsets.push_back(compactCFG.preds.size());
+        compactCFG.preds.insert(compactCFG.preds.end(), blockParents[id].begin(), blockParents[id].end());
+    }
+    compactCFG.succOffsets.push_back(compactCFG.succs.size());
+    compactCFG.predOffsets.push_back(compactCFG.preds.size());
+    blockNodes.clear();
+    blockParents.clear();
+    returnBlocks.clear();
 }
 
 // basic ast->cfg idea from The Fuzzing Book Appendix
-std::vector<CFGNode*> CFGCreator::traverse(AstNode* node, std::vector<CFGNode*> parents){
+std::vector<int> CFGCreator::traverse(AstNode* node, std::vector<int> parents){
     if(node->type == NodeType::ROOT || node->type == NodeType::STAT_LIST){
         // start chaining statements
-        std::vector<CFGNode*> node_parents = parents;
+        std::vector<int> node_parents = parents;
         for(auto* child : node->children){
+            if(node_parents.empty()){
+                // everything after a return is unreachable and gets no block
+                break;
+            }
             node_parents = traverse(child, node_parents);
         }
         return node_parents;
     }
     else if(node->type == NodeType::VARDECL){
-        CFGNode* new_node = new CFGNode(rid, parents, node);
-        registerCFGBlock(new_node);
-        return {new_node};
-        // std::vector<CFGNode*> node_parents = {};
+        return {registerCFGBlock(node, parents)};
     }
     else if(node->type == NodeType::IF){
-        CFGNode* new_node = new CFGNode(rid, parents, node);
-        registerCFGBlock(new_node);
+        int new_node = registerCFGBlock(node, parents);
         auto if_par =  traverse(node->children[1], {new_node});
         if(node->children.size() == 3){
             // has else statement
-            for(auto* par : traverse(node->children[2], {new_node})){
+            for(auto par : traverse(node->children[2], {new_node})){
                 if_par.push_back(par);
             }
         }
@@ -59,22 +72,27 @@ std::vector<CFGNode*> CFGCreator::traverse(AstNode* node, std::vector<CFGNode*>
         return if_par;
     }
     else if(node->type == NodeType::WHILE){
-        CFGNode* new_node = new CFGNode(rid, parents, node);
-        registerCFGBlock(new_node);
+        int new_node = registerCFGBlock(node, parents);
         auto backedge =  traverse(node->children[1], {new_node});
-        new_node->insertParent(backedge.at(0));
+        // every exit of the body loops back, not only the first
+        for(auto par : backedge){
+            blockParents[new_node].push_back(par);
+        }
         return {new_node};
     }
+    else if(node->type == NodeType::RETURN){
+        returnBlocks.push_back(registerCFGBlock(node, parents));
+        // nothing falls through a return
+        return {};
+    }
     return {};
 }
-CFGNode* CFGCreator::genCFG(AstNode* root){
-    CFGNode* cfg_root = new CFGNode(rid, {}, nullptr);
-    registerCFGBlock(cfg_root);
+void CFGCreator::genCFG(AstNode* root){
+    int cfg_root = registerCFGBlock(nullptr, {});
     auto end = traverse(root, {cfg_root});
-    CFGNode* cfg_end = new CFGNode(rid, end, nullptr);
-    registerCFGBlock(cfg_end);
-    resolveChildren();
-    return cfg_root;
+    end.insert(end.end(), returnBlocks.begin(), returnBlocks.end());
+    registerCFGBlock(nullptr, end);
+    freeze();
 }
 
 
@@ -83,16 +101,17 @@ void CFGCreator::outputCFG(std::string filename){
     std::ofstream outfile;
     outfile.open(filename, std::ios::trunc);
     outfile << "stateDiagram-v2" << std::endl;
-    for(auto elem : cfgBlocks){
-        std::string blockData = "(" + std::to_string(elem.second->id) + ") ";
-        if(!elem.second->astNode) {
-            blockData.append(elem.second->children.size() ? "START" : "END");
+    for(int id = 0; id < compactCFG.size(); ++id){
+        auto& block = compactCFG.blocks[id];
+        std::string blockData = "(" + std::to_string(id) + ") ";
+        if(!block.astNode) {
+            blockData.append(compactCFG.successors(id).size() ? "START" : "END");
         }else{
-            blockData.append(elem.second->astNode->toString());
+            blockData.append(block.astNode->toString());
         }
-        outfile << elem.second->id  << ": " << blockData << std::endl;
-        for(auto* child : elem.second->children){
-            outfile <<  elem.second->id << " --> " << child->id << std::endl;
+        outfile << id  << ": " << blockData << std::endl;
+        for(auto child : compactCFG.successors(id)){
+            outfile <<  id << " --> " << child << std::endl;
         }
     }  
     outfile.close();
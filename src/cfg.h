@@ -9,40 +9,58 @@
 using namespace antlrcpp;
 using namespace antlr4;
 
-class CFGNode {
-public:
-	int id;
-	AstNode *astNode;
+// per block payload, stored by value in the frozen cfg
+struct CFGNode {
+	AstNode *astNode = nullptr;
 
 	std::unordered_set<std::string> varkill {};
 	std::unordered_set<std::string> uevar {};
 	std::unordered_set<std::string> liveout {};
+};
 
-	std::vector<CFGNode *> children;
-	std::vector<CFGNode *> parents;
+// contiguous ids [first, last) of a block's successors or predecessors
+struct BlockRange {
+	const int *first;
+	const int *last;
+	const int *begin() const {return first;};
+	const int *end() const {return last;};
+	int size() const {return last - first;};
+};
 
-	CFGNode(){};
-	CFGNode(int id, std::vector<CFGNode *> parents, AstNode* node) : 
-		id(id), 
-		parents(parents),
-		astNode(node)
-		{};
+// finished cfg frozen into compressed sparse row arrays indexed by the
+// dense block id, edges are only kept here
+struct CompactCFG {
+	std::vector<int> succOffsets;
+	std::vector<int> succs;
+	std::vector<int> predOffsets;
+	std::vector<int> preds;
+	// per block payload, liveness sets and ast statement
+	std::vector<CFGNode> blocks;
 
-	void insertChild(CFGNode* node);
-	void insertParent(CFGNode* node);
+	int size() const {return blocks.size();};
+	BlockRange successors(int id) const {
+		return {succs.data() + succOffsets[id], succs.data() + succOffsets[id + 1]};
+	};
+	BlockRange predecessors(int id) const {
+		return {preds.data() + predOffsets[id], preds.data() + predOffsets[id + 1]};
+	};
 };
 
 class CFGCreator
 {
 private:
-	int rid = 0;
-	std::unordered_map<int, CFGNode*> cfgBlocks;
-	void registerCFGBlock(CFGNode *);
-	void resolveChildren();
-	std::vector<CFGNode *> traverse(AstNode *node, std::vector<CFGNode *> parents);
+	// statement and predecessor ids of every block while building
+	std::vector<AstNode*> blockNodes;
+	std::vector<std::vector<int>> blockParents;
+	// returns jump straight to the end block
+	std::vector<int> returnBlocks;
+	CompactCFG compactCFG;
+	int registerCFGBlock(AstNode *node, std::vector<int> parents);
+	void freeze();
+	std::vector<int> traverse(AstNode *node, std::vector<int> parents);
 public:
-	CFGNode *genCFG(AstNode *root);
+	void genCFG(AstNode *root);
 	void outputCFG(std::string filename);
-	std::unordered_map<int, CFGNode*>& getCFGBlocks() {return cfgBlocks;};
+	CompactCFG& getCFG() {return compactCFG;};
 	
 };
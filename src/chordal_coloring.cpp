@@ -0,0 +1,207 @@
+#include "chordal_coloring.h"
+
+void ChordalColoring::computeLiveness(){
+    int n = ssa.size();
+    auto& cfg = ssa.getCFG();
+    liveIn.assign(n, {});
+    liveOut.assign(n, {});
+    bool changed = true;
+    while(changed){
+        changed = false;
+        for(int b = n - 1; b >= 0; --b){
+            auto& block = ssa.getBlock(b);
+            std::unordered_set<std::string> out;
+            for(auto child : cfg.successors(b)){
+                out.insert(liveIn[child].begin(), liveIn[child].end());
+                // phi operands are read at the end of the parent
+                for(auto& phi : ssa.getBlock(child).phis){
+                    out.insert(phi.sources.at(b));
+                }
+            }
+            std::unordered_set<std::string> in = out;
+            in.erase(block.def);
+            for(auto u : block.uses){
+                in.insert(u.second);
+            }
+            for(auto& phi : block.phis){
+                in.erase(phi.dest);
+            }
+            if(out != liveOut[b] || in != liveIn[b]){
+                liveOut[b] = out;
+                liveIn[b] = in;
+                changed = true;
+            }
+        }
+    }
+}
+
+void ChordalColoring::collectLivePoints(){
+    phiPoint.assign(ssa.size(), -1);
+    defPoint.assign(ssa.size(), -1);
+    for(int b = 0; b < ssa.size(); ++b){
+        auto& block = ssa.getBlock(b);
+        auto live = liveOut[b];
+        if(!block.def.empty()){
+            // the def is live together with everything live after it
+            live.insert(block.def);
+            defPoint[b] = livePoints.size();
+            livePoints.push_back(live);
+            live.erase(block.def);
+        }
+        for(auto u : block.uses){
+            live.insert(u.second);
+        }
+        livePoints.push_back(live);
+        if(block.phis.size()){
+            for(auto& phi : block.phis){
+                live.insert(phi.dest);
+            }
+            phiPoint[b] = livePoints.size();
+            livePoints.push_back(live);
+        }
+    }
+}
+
+void ChordalColoring::spillToPressure(){
+    // max clique of a chordal graph is the largest live point, one sweep
+    // spills the cheapest value of every overloaded point, the counts of
+    // the points a spill leaves are lowered so earlier points stay within k
+    std::vector<int> pressure(livePoints.size());
+    std::unordered_map<std::string, std::vector<int>> pointsOf;
+    for(int i = 0; i < livePoints.size(); ++i){
+        pressure[i] = livePoints[i].size();
+        for(auto& name : livePoints[i]){
+            pointsOf[name].push_back(i);
+        }
+    }
+    for(int i = 0; i < livePoints.size(); ++i){
+        while(pressure[i] > totalRegisters){
+            std::string spillName;
+            double minCost = 0;
+            for(auto& name : livePoints[i]){
+                if(regMap.count(name)) {continue;}
+                double cost = spillCost ? spillCost->getCost(ssa.getVar(name)) : 1;
+                if(spillName.empty() || cost < minCost || (cost == minCost && name < spillName)){
+                    minCost = cost;
+                    spillName = name;
+                }
+            }
+            regMap[spillName] = -1;
+            for(auto j : pointsOf[spillName]){
+                pressure[j]--;
+            }
+        }
+    }
+    for(auto p : pressure){
+        maxPressure = std::max(maxPressure, p);
+    }
+}
+
+void ChordalColoring::colorValue(const std::string& name, const std::unordered_set<std::string>& live){
+    if(regMap.count(name)){
+        // spilled or already colored
+        return;
+    }
+    // in dominance order everything else live here is colored already
+    std::unordered_set<int> used;
+    for(auto& other : live){
+        auto it = regMap.find(other);
+        if(other != name && it != regMap.end() && it->second != -1){
+            used.insert(it->second);
+        }
+    }
+    int reg = 0;
+    while(used.count(reg)){
+        reg++;
+    }
+    // cannot happen once pressure fits, kept as a safety net
+    regMap[name] = reg < totalRegisters ? reg : -1;
+}
+
+void ChordalColoring::colorInDominanceOrder(){
+    // values read before any definition are all live in the start block
+    std::unordered_set<std::string> entry(ssa.getEntryNames().begin(), ssa.getEntryNames().end());
+    for(auto& name : ssa.getEntryNames()){
+        colorValue(name, entry);
+    }
+    std::vector<int> work = {0};
+    while(!work.empty()){
+        int b = work.back();
+        work.pop_back();
+        auto& block = ssa.getBlock(b);
+        for(auto& phi : block.phis){
+            colorValue(phi.dest, livePoints[phiPoint[b]]);
+        }
+        if(!block.def.empty()){
+            colorValue(block.def, livePoints[defPoint[b]]);
+        }
+        auto& domKids = ssa.getDomChildren(b);
+        for(auto it = domKids.rbegin(); it != domKids.rend(); ++it){
+            work.push_back(*it);
+        }
+    }
+}
+
+void ChordalColoring::allocateRegisters(){
+    computeLiveness();
+    collectLivePoints();
+    spillToPressure();
+    colorInDominanceOrder();
+
+    std::cout << "SSA Chordal Coloring Results:" << std::endl;
+    for(auto elem : regMap){
+        std::cout << elem.first << ": " << location(elem.first) << std::endl;
+    }
+    std::cout << "Max pressure: " << maxPressure << std::endl;
+}
+
+std::string ChordalColoring::location(const std::string& name){
+    int reg = regMap.count(name) ? regMap.at(name) : -1;
+    if(reg != -1){
+        return "r" + std::to_string(reg);
+    }
+    auto var = ssa.getVar(name);
+    if(spillCost && spillCost->isRemat(var)){
+        return "remat " + spillCost->getConstant(var);
+    }
+    return "[" + name + "]";
+}
+
+int ChordalColoring::outputParallelCopies(){
+    int copies = 0;
+    auto& cfg = ssa.getCFG();
+    std::cout << "Parallel Copies:" << std::endl;
+    for(int b = 0; b < ssa.size(); ++b){
+        auto& block = ssa.getBlock(b);
+        if(block.phis.empty()) {continue;}
+        for(auto p : cfg.predecessors(b)){
+            std::string line;
+            for(auto& phi : block.phis){
+                auto var = ssa.getVar(phi.dest);
+                if(regMap.at(phi.dest) == -1 && spillCost && spillCost->isRemat(var)){
+                    // constants are re-emitted at their uses, nothing to move
+                    continue;
+                }
+                auto dest = location(phi.dest);
+                auto src = location(phi.sources.at(p));
+                if(dest == src) {continue;}
+                line += (line.empty() ? "" : ", ") + dest + " <- " + src;
+                copies++;
+            }
+            if(!line.empty()){
+                std::cout << "(" << p << " -> " << b << ") " << line << std::endl;
+            }
+        }
+    }
+    return copies;
+}
+
+int ChordalColoring::getSpillCount(){
+    std::unordered_set<std::string> spilled;
+    for(auto elem : regMap){
+        if(elem.second == -1){
+            spilled.insert(ssa.getVar(elem.first));
+        }
+    }
+    return spilled.size();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "ssa.h"
+#include "spill_cost.h"
+
+// ssa interference graphs are chordal, coloring definitions in dominance
+// order is a perfect elimination order so max pressure colors suffice
+class ChordalColoring{
+    private:
+        SSAForm& ssa;
+        int totalRegisters;
+        const SpillCost* spillCost = nullptr;
+        // ssa name -> register, -1 spilled
+        std::unordered_map<std::string, int> regMap;
+        // sets of ssa names live at the same program point
+        std::vector<std::unordered_set<std::string>> livePoints;
+        // live point right after the phis and right after the def of every block, -1 if none
+        std::vector<int> phiPoint;
+        std::vector<int> defPoint;
+        std::vector<std::unordered_set<std::string>> liveIn;
+        std::vector<std::unordered_set<std::string>> liveOut;
+        int maxPressure = 0;
+
+        void computeLiveness();
+        void collectLivePoints();
+        void spillToPressure();
+        // lowest register not held by another colored value live with name
+        void colorValue(const std::string& name, const std::unordered_set<std::string>& live);
+        void colorInDominanceOrder();
+        std::string location(const std::string& name);
+    public:
+        ChordalColoring(SSAForm& form, int registers): 
+            ssa(form),
+            totalRegisters(registers) 
+            {};
+
+        void setSpillCost(const SpillCost& costs) {spillCost = &costs;};
+        void allocateRegisters();
+        // out of ssa, one parallel copy per cfg edge into a block with phis
+        int outputParallelCopies();
+        int getMaxPressure() {return maxPressure;};
+        // distinct source variables with any spilled ssa value
+        int getSpillCount();
+};
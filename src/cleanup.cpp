@@ -0,0 +1,359 @@
+#include "cleanup.h"
+#include "liveout.h"
+#include <set>
+
+static LatticeValue constant(long value){
+    return {LATTICE_CONST, value};
+}
+
+static LatticeValue varying(){
+    return {LATTICE_VARYING, 0};
+}
+
+static LatticeValue meet(LatticeValue a, LatticeValue b){
+    if(a.kind == LATTICE_UNDEF) {return b;}
+    if(b.kind == LATTICE_UNDEF) {return a;}
+    if(a.kind == LATTICE_CONST && b.kind == LATTICE_CONST && a.value == b.value) {return a;}
+    return varying();
+}
+
+static long applyOp(const std::string& op, long lhs, long rhs){
+    if(op == "+") {return lhs + rhs;}
+    if(op == "-") {return lhs - rhs;}
+    if(op == ">") {return lhs > rhs;}
+    return lhs < rhs;
+}
+
+static int countStatements(AstNode* node){
+    if(node->type == NodeType::VARDECL || node->type == NodeType::RETURN){
+        return 1;
+    }
+    int count = node->type == NodeType::IF || node->type == NodeType::WHILE;
+    for(auto* child : node->children){
+        if(child->type == NodeType::STAT_LIST){
+            count += countStatements(child);
+        }
+    }
+    if(node->type == NodeType::ROOT || node->type == NodeType::STAT_LIST){
+        for(auto* child : node->children){
+            count += countStatements(child);
+        }
+    }
+    return count;
+}
+
+static void collectVars(AstNode* node, std::unordered_set<std::string>& vars){
+    if(node->type == NodeType::VAR){
+        vars.insert(node->value);
+    }
+    for(auto* child : node->children){
+        collectVars(child, vars);
+    }
+}
+
+LatticeValue CleanupPass::evaluate(AstNode* expr, SSABlock& block){
+    switch(expr->type){
+        case NodeType::NUM:
+            return constant(std::stol(expr->value));
+        case NodeType::VAR:{
+            auto it = block.uses.find(expr->value);
+            if(it == block.uses.end() || !lattice.count(it->second)){
+                return varying();
+            }
+            return lattice.at(it->second);
+        }
+        case NodeType::OP:
+        case NodeType::CMPOP:{
+            auto lhs = evaluate(expr->children.at(0), block);
+            auto rhs = evaluate(expr->children.at(1), block);
+            if(lhs.kind == LATTICE_VARYING || rhs.kind == LATTICE_VARYING) {return varying();}
+            if(lhs.kind == LATTICE_UNDEF || rhs.kind == LATTICE_UNDEF) {return LatticeValue();}
+            return constant(applyOp(expr->value, lhs.value, rhs.value));
+        }
+        default:
+            // calls are not followed
+            return varying();
+    }
+}
+
+// Wegman, Zadeck: Constant Propagation with Conditional Branches
+void CleanupPass::propagate(SSAForm& ssa){
+    auto& cfg = ssa.getCFG();
+    lattice.clear();
+    branchValues.clear();
+    executable.assign(cfg.size(), false);
+    std::set<std::pair<int, int>> executableEdges;
+    std::vector<std::pair<int, int>> flowWork = {{-1, 0}};
+    std::vector<std::string> ssaWork;
+
+    // blocks reading each ssa name, in a phi or the statement
+    std::unordered_map<std::string, std::vector<int>> readers;
+    for(int b = 0; b < cfg.size(); ++b){
+        auto& block = ssa.getBlock(b);
+        for(auto& phi : block.phis){
+            for(auto& source : phi.sources){
+                readers[source.second].push_back(b);
+            }
+        }
+        for(auto& use : block.uses){
+            readers[use.second].push_back(b);
+        }
+    }
+    // read before any def, nothing is known about them
+    for(auto& name : ssa.getEntryNames()){
+        lattice[name] = varying();
+    }
+
+    auto setValue = [&](const std::string& name, LatticeValue value){
+        auto& current = lattice[name];
+        if(current.kind != value.kind || current.value != value.value){
+            current = value;
+            ssaWork.push_back(name);
+        }
+    };
+    auto visit = [&](int b){
+        auto& block = ssa.getBlock(b);
+        for(auto& phi : block.phis){
+            LatticeValue value;
+            for(auto& source : phi.sources){
+                if(executableEdges.count({source.first, b}) && lattice.count(source.second)){
+                    value = meet(value, lattice.at(source.second));
+                }
+            }
+            setValue(phi.dest, value);
+        }
+        auto* astNode = cfg.blocks[b].astNode;
+        auto successors = cfg.successors(b);
+        if(astNode && astNode->type == NodeType::VARDECL){
+            setValue(block.def, evaluate(astNode->children.at(1), block));
+        }
+        else if(astNode && (astNode->type == NodeType::IF || astNode->type == NodeType::WHILE)
+            && successors.size() == 2){
+            // the body starts right after the branch, the other edge is the false one
+            auto value = evaluate(astNode->children.at(0), block);
+            branchValues[astNode] = value;
+            for(auto child : successors){
+                bool taken = value.kind == LATTICE_VARYING
+                    || (value.kind == LATTICE_CONST && (child == b + 1) == (value.value != 0));
+                if(taken){
+                    flowWork.push_back({b, child});
+                }
+            }
+            return;
+        }
+        for(auto child : successors){
+            flowWork.push_back({b, child});
+        }
+    };
+
+    while(!flowWork.empty() || !ssaWork.empty()){
+        if(!flowWork.empty()){
+            auto edge = flowWork.back();
+            flowWork.pop_back();
+            if(executableEdges.count(edge)){
+                continue;
+            }
+            executableEdges.insert(edge);
+            executable[edge.second] = true;
+            // first visit evaluates the block, later ones only add a phi input
+            visit(edge.second);
+            continue;
+        }
+        auto name = ssaWork.back();
+        ssaWork.pop_back();
+        for(auto b : readers[name]){
+            if(executable[b]){
+                visit(b);
+            }
+        }
+    }
+}
+
+// the grammar has no negative literals, so a negative constant is only
+// substituted where it can flip the + or - in front of it
+AstNode* CleanupPass::substitute(AstNode* expr, SSABlock& block){
+    auto constantOf = [&](AstNode* var, long& value){
+        auto it = block.uses.find(var->value);
+        if(it == block.uses.end() || !lattice.count(it->second)
+            || lattice.at(it->second).kind != LATTICE_CONST){
+            return false;
+        }
+        value = lattice.at(it->second).value;
+        return true;
+    };
+    long value;
+    if(expr->type == NodeType::VAR){
+        if(constantOf(expr, value) && value >= 0){
+            propagated++;
+            return new AstNode(std::to_string(value), NodeType::NUM);
+        }
+        return expr;
+    }
+    for(auto& child : expr->children){
+        child = substitute(child, block);
+    }
+    if(expr->type == NodeType::OP && expr->children.at(1)->type == NodeType::VAR
+        && constantOf(expr->children.at(1), value) && value < 0){
+        // x + y with y = -c is x - c
+        propagated++;
+        expr->value = expr->value == "+" ? "-" : "+";
+        expr->children.at(1) = new AstNode(std::to_string(-value), NodeType::NUM);
+    }
+    if((expr->type == NodeType::OP || expr->type == NodeType::CMPOP)
+        && expr->children.at(0)->type == NodeType::NUM && expr->children.at(1)->type == NodeType::NUM){
+        value = applyOp(expr->value, std::stol(expr->children.at(0)->value),
+            std::stol(expr->children.at(1)->value));
+        if(value >= 0){
+            folded++;
+            return new AstNode(std::to_string(value), NodeType::NUM);
+        }
+    }
+    return expr;
+}
+
+void CleanupPass::rewriteList(AstNode* list, SSAForm& ssa){
+    std::vector<AstNode*> kept;
+    for(auto* stat : list->children){
+        if(!blockOf.count(stat) || !executable[blockOf.at(stat)]){
+            // never reached
+            removedStatements += countStatements(stat);
+            continue;
+        }
+        auto& block = ssa.getBlock(blockOf.at(stat));
+        if(stat->type == NodeType::VARDECL){
+            stat->children.at(1) = substitute(stat->children.at(1), block);
+        }
+        else if(stat->type == NodeType::RETURN){
+            stat->children.at(0) = substitute(stat->children.at(0), block);
+        }
+        else if(stat->type == NodeType::IF){
+            auto value = branchValues[stat];
+            if(value.kind == LATTICE_CONST){
+                // only one side can run, splice it in place of the if
+                removedStatements++;
+                AstNode* taken = value.value ? stat->children.at(1)
+                    : (stat->children.size() == 3 ? stat->children.at(2) : nullptr);
+                if(taken){
+                    rewriteList(taken, ssa);
+                    kept.insert(kept.end(), taken->children.begin(), taken->children.end());
+                }
+                AstNode* skipped = value.value && stat->children.size() == 3 ? stat->children.at(2)
+                    : (value.value ? nullptr : stat->children.at(1));
+                if(skipped){
+                    removedStatements += countStatements(skipped);
+                }
+                continue;
+            }
+            stat->children.at(0) = substitute(stat->children.at(0), block);
+            rewriteList(stat->children.at(1), ssa);
+            if(stat->children.size() == 3){
+                rewriteList(stat->children.at(2), ssa);
+            }
+        }
+        else if(stat->type == NodeType::WHILE){
+            auto value = branchValues[stat];
+            if(value.kind == LATTICE_CONST && !value.value){
+                removedStatements += countStatements(stat);
+                continue;
+            }
+            stat->children.at(0) = substitute(stat->children.at(0), block);
+            rewriteList(stat->children.at(1), ssa);
+        }
+        kept.push_back(stat);
+    }
+    list->children = kept;
+}
+
+void CleanupPass::removeStatements(AstNode* list, const std::unordered_set<AstNode*>& dead){
+    std::vector<AstNode*> kept;
+    for(auto* stat : list->children){
+        if(dead.count(stat)){
+            continue;
+        }
+        if(stat->type == NodeType::IF){
+            removeStatements(stat->children.at(1), dead);
+            if(stat->children.size() == 3){
+                removeStatements(stat->children.at(2), dead);
+                if(stat->children.at(2)->children.empty()){
+                    stat->children.pop_back();
+                }
+            }
+            if(stat->children.at(1)->children.empty() && stat->children.size() == 2){
+                // nothing left on either side, the condition has no effect
+                removedStatements++;
+                continue;
+            }
+        }
+        else if(stat->type == NodeType::WHILE){
+            // an emptied loop still decides whether the program terminates
+            removeStatements(stat->children.at(1), dead);
+        }
+        kept.push_back(stat);
+    }
+    list->children = kept;
+}
+
+bool CleanupPass::removeDeadStores(AstNode* root, const std::unordered_set<std::string>& finalValues){
+    CFGCreator cfgCreator;
+    cfgCreator.genCFG(root);
+    auto& cfg = cfgCreator.getCFG();
+    LiveOut liveout(cfg);
+    liveout.prepCFG();
+    // END has no successors, its liveout is only ever what is seeded here
+    cfg.blocks.back().liveout = finalValues;
+    liveout.computeLiveOut();
+
+    // a def nobody reads afterwards, statements have no side effects
+    std::unordered_set<AstNode*> dead;
+    for(auto& block : cfg.blocks){
+        auto* astNode = block.astNode;
+        if(astNode && astNode->type == NodeType::VARDECL
+            && !block.liveout.count(astNode->children.at(0)->value)){
+            dead.insert(astNode);
+        }
+    }
+    if(dead.empty()){
+        return false;
+    }
+    removedStatements += dead.size();
+    removeStatements(root, dead);
+    return true;
+}
+
+void CleanupPass::run(AstNode* root, bool keepFinalValues){
+    std::unordered_set<std::string> varsBefore;
+    collectVars(root, varsBefore);
+    std::unordered_set<std::string> finalValues;
+    if(keepFinalValues){
+        finalValues = varsBefore;
+    }
+
+    {
+        CFGCreator cfgCreator;
+        cfgCreator.genCFG(root);
+        auto& cfg = cfgCreator.getCFG();
+        LiveOut liveout(cfg);
+        liveout.prepCFG();
+        liveout.computeLiveOut();
+        SSAForm ssa(cfg);
+        ssa.build();
+
+        blockOf.clear();
+        for(int b = 0; b < cfg.size(); ++b){
+            if(cfg.blocks[b].astNode){
+                blockOf[cfg.blocks[b].astNode] = b;
+            }
+        }
+        propagate(ssa);
+        rewriteList(root, ssa);
+    }
+
+    // removing a store can make the stores feeding it dead too
+    while(removeDeadStores(root, finalValues)){
+        deadStoreRounds++;
+    }
+
+    std::unordered_set<std::string> varsAfter;
+    collectVars(root, varsAfter);
+    removedVariables += varsBefore.size() - varsAfter.size();
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "ast.h"
+#include "ssa.h"
+
+enum LatticeKind{
+    LATTICE_UNDEF,
+    LATTICE_CONST,
+    LATTICE_VARYING
+};
+
+// value of an ssa name during constant propagation, only ever moves
+// down from undef to one constant to varying
+struct LatticeValue{
+    LatticeKind kind = LATTICE_UNDEF;
+    long value = 0;
+};
+
+// pre-allocation cleanup on the ast: sparse conditional constant
+// propagation and folding over ssa, then dead-store elimination on the
+// liveness results until nothing more is dead
+class CleanupPass{
+    private:
+        std::unordered_map<std::string, LatticeValue> lattice;
+        std::vector<bool> executable;
+        // condition value of every reached if/while
+        std::unordered_map<AstNode*, LatticeValue> branchValues;
+        std::unordered_map<AstNode*, int> blockOf;
+
+        // stats over every run
+        int propagated = 0;
+        int folded = 0;
+        int removedStatements = 0;
+        int removedVariables = 0;
+        int deadStoreRounds = 0;
+
+        LatticeValue evaluate(AstNode* expr, SSABlock& block);
+        void propagate(SSAForm& ssa);
+        AstNode* substitute(AstNode* expr, SSABlock& block);
+        void rewriteList(AstNode* list, SSAForm& ssa);
+        // one round of liveness, false once no store is dead; variables in
+        // finalValues are read at the end of the program
+        bool removeDeadStores(AstNode* root, const std::unordered_set<std::string>& finalValues);
+        void removeStatements(AstNode* list, const std::unordered_set<AstNode*>& dead);
+    public:
+        // cleans a ROOT or STAT_LIST in place, for main the last value of
+        // every variable is the program's result and its store is kept
+        void run(AstNode* root, bool keepFinalValues = false);
+        int getPropagated() {return propagated;};
+        int getFolded() {return folded;};
+        int getRemovedStatements() {return removedStatements;};
+        int getRemovedVariables() {return removedVariables;};
+        int getDeadStoreRounds() {return deadStoreRounds;};
+};
@@ -0,0 +1,174 @@
+#include "functions.h"
+#include "graph_coloring.h"
+#include "spill_cost.h"
+#include "thread_pool.h"
+#include <chrono>
+#include <set>
+
+static void checkCalls(AstNode* node, const std::unordered_map<std::string, int>& arity){
+    if(node->type == NodeType::CALL){
+        if(!arity.count(node->value)){
+            std::cerr << "Call to undefined function " << node->value << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if(arity.at(node->value) != node->children.size()){
+            std::cerr << "Function " << node->value << " takes " << arity.at(node->value)
+                      << " arguments, called with " << node->children.size() << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    for(auto* child : node->children){
+        checkCalls(child, arity);
+    }
+}
+
+static bool hasCall(AstNode* node){
+    if(node->type == NodeType::CALL){
+        return true;
+    }
+    for(auto* child : node->children){
+        // nested statements are their own blocks
+        if(child->type != NodeType::STAT_LIST && hasCall(child)){
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Function> splitFunctions(AstNode* root){
+    std::vector<Function> functions;
+    std::vector<AstNode*> statements;
+    std::unordered_map<std::string, int> arity;
+    for(auto* child : root->children){
+        if(child->type != NodeType::FUNC){
+            statements.push_back(child);
+            continue;
+        }
+        // children: params..., body
+        Function function{child->value, {}, child->children.back()};
+        for(int i = 0; i + 1 < child->children.size(); ++i){
+            function.params.push_back(child->children[i]->value);
+        }
+        if(function.name == "main" || arity.count(function.name)){
+            std::cerr << "Function " << function.name << " is already defined" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        arity[function.name] = function.params.size();
+        functions.push_back(function);
+    }
+    root->children = statements;
+
+    checkCalls(root, arity);
+    for(auto& function : functions){
+        checkCalls(function.body, arity);
+    }
+    return functions;
+}
+
+FunctionAllocation FunctionAllocator::allocate(const Function& function){
+    auto start = std::chrono::steady_clock::now();
+    FunctionAllocation result;
+    result.signature = function.name + "(";
+    for(int i = 0; i < function.params.size(); ++i){
+        result.signature += (i ? ", " : "") + function.params[i];
+    }
+    result.signature += ")";
+
+    // parameters are read before any def, so they are live out of START
+    CFGCreator cfgCreator;
+    cfgCreator.genCFG(function.body);
+    auto& cfg = cfgCreator.getCFG();
+    LiveOut liveout(cfg);
+    liveout.prepCFG();
+    liveout.computeLiveOut();
+    SpillCost spillCost(findRematerializable(function.body, cfg, function.params));
+    spillCost.computeCosts(cfg);
+
+    // values still needed after each call, the call's own def excluded
+    std::vector<std::unordered_set<std::string>> acrossCalls;
+    std::unordered_set<std::string> crossing;
+    for(auto& block : cfg.blocks){
+        if(!block.astNode || !hasCall(block.astNode)){
+            continue;
+        }
+        auto across = block.liveout;
+        if(block.astNode->type == NodeType::VARDECL){
+            across.erase(block.astNode->children.at(0)->value);
+        }
+        crossing.insert(across.begin(), across.end());
+        acrossCalls.push_back(across);
+    }
+
+    GraphColoring coloring(totalRegisters);
+    coloring.setVerbose(false);
+    coloring.setSpillCost(spillCost);
+    coloring.setCallInfo(crossing, callerSaved);
+    coloring.createGraph(cfg);
+    coloring.colorGraph();
+
+    result.regMap = coloring.getRegMap();
+    result.blocks = cfg.size();
+    result.spills = coloring.getSpillCount();
+    result.callSites = acrossCalls.size();
+    for(auto& across : acrossCalls){
+        for(auto v : across){
+            int reg = result.regMap.count(v) ? result.regMap.at(v) : -1;
+            result.callerSaves += reg != -1 && reg < callerSaved;
+        }
+    }
+    if(function.name != "main"){
+        // main has no caller to preserve registers for
+        std::set<int> used;
+        for(auto elem : result.regMap){
+            if(elem.second >= callerSaved){
+                used.insert(elem.second);
+            }
+        }
+        result.calleeSaves = used.size();
+    }
+    result.micros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void FunctionAllocator::allocateAll(const std::vector<Function>& functions, int threads){
+    auto start = std::chrono::steady_clock::now();
+    allocations.assign(functions.size(), FunctionAllocation());
+    ThreadPool pool(threads);
+    threadCount = pool.size();
+    for(int i = 0; i < functions.size(); ++i){
+        // each task only writes its own slot
+        pool.submit([this, &functions, i](){
+            allocations[i] = allocate(functions[i]);
+        });
+    }
+    pool.wait();
+    wallMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void FunctionAllocator::printResults(){
+    std::cout << "Per-Function Allocation (" << allocations.size() << " functions, "
+              << threadCount << " threads, r0-r" << callerSaved - 1 << " caller-saved):" << std::endl;
+    long summed = 0;
+    int largest = 0;
+    for(int i = 0; i < allocations.size(); ++i){
+        auto& allocation = allocations[i];
+        std::cout << "Function " << allocation.signature << ": "
+                  << allocation.blocks << " blocks, "
+                  << allocation.spills << " spills, "
+                  << allocation.callSites << " call sites, "
+                  << allocation.callerSaves << " caller saves, "
+                  << allocation.calleeSaves << " callee saves, "
+                  << allocation.micros << "us" << std::endl;
+        for(auto elem : allocation.regMap){
+            std::cout << elem.first << ": r" << elem.second << std::endl;
+        }
+        summed += allocation.micros;
+        if(allocation.micros > allocations[largest].micros){
+            largest = i;
+        }
+    }
+    std::cout << "Functions: " << wallMicros << "us wall, " << summed << "us summed, slowest "
+              << allocations[largest].signature << " " << allocations[largest].micros << "us" << std::endl;
+}
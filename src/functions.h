@@ -0,0 +1,52 @@
+#pragma once
+#include "cfg.h"
+#include "liveout.h"
+
+// a function definition, the top level statements are "main"
+struct Function{
+    std::string name;
+    std::vector<std::string> params;
+    AstNode* body;
+};
+
+// takes the FUNC nodes out of root, leaving it with main's statements, and
+// checks every call names a defined function with the right argument count
+std::vector<Function> splitFunctions(AstNode* root);
+
+// allocation of one function
+struct FunctionAllocation{
+    std::string signature;
+    int blocks = 0;
+    int spills = 0;
+    int callSites = 0;
+    // values in caller-saved registers live across a call, a save and a
+    // restore around the call each
+    int callerSaves = 0;
+    // callee-saved registers the function writes, saved in its prologue
+    int calleeSaves = 0;
+    long micros = 0;
+    std::unordered_map<std::string, int> regMap;
+};
+
+// liveness and graph coloring of every function on its own, spread over a
+// thread pool, registers [0, (k+1)/2) are caller-saved and the rest callee-saved
+class FunctionAllocator{
+    private:
+        int totalRegisters;
+        int callerSaved;
+        std::vector<FunctionAllocation> allocations;
+        long wallMicros = 0;
+        int threadCount = 0;
+
+        FunctionAllocation allocate(const Function& function);
+    public:
+        FunctionAllocator(int registers):
+            totalRegisters(registers),
+            callerSaved((registers + 1) / 2)
+            {};
+
+        // 0 threads uses one per core
+        void allocateAll(const std::vector<Function>& functions, int threads);
+        void printResults();
+        std::vector<FunctionAllocation>& getAllocations() {return allocations;};
+};
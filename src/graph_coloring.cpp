@@ -1,22 +1,64 @@
 #include "graph_coloring.h"
 
-void GraphColoring::createGraph(std::unordered_map<int, CFGNode*>& cfgBlocks){
-    for(auto elem : cfgBlocks){
-        auto* cfgNode = elem.second;
-        if(cfgNode->liveout.size()){
-            for(auto a : cfgNode->liveout){
-                if(!graph.count(a)){
-                    graph[a] = {};
-                }
-                for(auto z : cfgNode->liveout){
-                    if(a != z){
-                        graph[a].insert(z);
-                    }
+void blockInterference(const CFGNode& block, bool start,
+                       const std::function<void(const std::string&)>& addNode,
+                       const std::function<void(const std::string&, const std::string&)>& addEdge){
+    for(auto& v : block.liveout){
+        addNode(v);
+    }
+    if(start){
+        // values read before any def all arrive in the start block
+        for(auto& a : block.liveout){
+            for(auto& z : block.liveout){
+                if(a < z){
+                    addEdge(a, z);
                 }
             }
         }
     }
+    auto* astNode = block.astNode;
+    if(!astNode || astNode->type != NodeType::VARDECL){
+        return;
+    }
+    // Appel's build rule: the def interferes with everything live after
+    // it, except the source of a copy "x = y", which may share its register
+    auto dest = astNode->children.at(0)->value;
+    std::string src;
+    if(astNode->children.at(1)->type == NodeType::VAR){
+        src = astNode->children.at(1)->value;
+    }
+    // a dead def still needs a register to write to
+    addNode(dest);
+    for(auto& v : block.liveout){
+        if(v != dest && v != src){
+            addEdge(dest, v);
+        }
+    }
+}
+
+void GraphColoring::createGraph(CompactCFG& cfg){
+    auto addNode = [&](const std::string& v){
+        graph[v];
+    };
+    auto addEdge = [&](const std::string& a, const std::string& z){
+        graph[a].insert(z);
+        graph[z].insert(a);
+    };
+    for(int id = 0; id < cfg.size(); ++id){
+        if(pollCancel()){
+            return;
+        }
+        auto& cfgNode = cfg.blocks[id];
+        blockInterference(cfgNode, id == 0, addNode, addEdge);
+        auto* astNode = cfgNode.astNode;
+        if(astNode && astNode->type == NodeType::VARDECL && astNode->children.at(1)->type == NodeType::VAR
+            && astNode->children.at(0)->value != astNode->children.at(1)->value){
+            // candidate for coalescing
+            moves.push_back(std::make_pair(astNode->children.at(0)->value, astNode->children.at(1)->value));
+        }
+    }
 
+    if(!verbose) {return;}
     std::cout << "Graph:" << std::endl;
     for(auto elem : graph){
         std::cout << elem.first << ": ";
@@ -28,8 +70,179 @@ void GraphColoring::createGraph(std::unordered_map<int, CFGNode*>& cfgBlocks){
     std::cout << std::endl;
 }
 
-int randNum(int from, int to){
-    return rand()%(to-from + 1) + from;
+bool GraphColoring::pollCancel(){
+    if(cancelFlag && cancelFlag->load(std::memory_order_relaxed)){
+        cancelled = true;
+    }
+    return cancelled;
+}
+
+std::string GraphColoring::getAlias(const std::string& node){
+    std::string n = node;
+    while(alias.count(n)){
+        n = alias.at(n);
+    }
+    return n;
+}
+
+bool GraphColoring::isMoveRelated(const std::string& node){
+    for(auto m : moves){
+        if(getAlias(m.first) == node || getAlias(m.second) == node){
+            return true;
+        }
+    }
+    return false;
+}
+
+void GraphColoring::dropMoves(const std::string& node){
+    std::vector<moveInst> kept;
+    for(auto m : moves){
+        if(getAlias(m.first) != node && getAlias(m.second) != node){
+            kept.push_back(m);
+        }
+    }
+    moves = kept;
+}
+
+double GraphColoring::nodeCost(const std::string& node){
+    if(!spillCost){
+        return 1;
+    }
+    // a coalesced node spills every variable merged into it
+    double cost = 0;
+    bool merged = false;
+    for(auto elem : alias){
+        if(getAlias(elem.first) == node){
+            cost += spillCost->getCost(elem.first);
+            merged = true;
+        }
+    }
+    return merged ? cost + spillCost->getCost(node) : spillCost->getCost(node);
+}
+
+graphPair GraphColoring::unlinkNode(const std::string& node){
+    graphPair toRemove = *graph.find(node);
+    // remove from links
+    for(auto v : toRemove.second){
+        graph[v].erase(toRemove.first);
+    }
+    graph.erase(toRemove.first);
+    // std::cout << "remove: " << toRemove.first << std::endl;
+    return toRemove;
+}
+
+bool GraphColoring::removeOneNode(std::stack<graphPair>& removals){
+    // find the first elem that has < register num connects and is not
+    // waiting on a coalesce, and remove
+    for(auto elem : graph){
+        if(pollCancel()){
+            return true;
+        }
+        if(elem.second.size() < totalRegisters && !isMoveRelated(elem.first)){
+            // found our guy
+            removals.push(unlinkNode(elem.first));
+            return true;
+        }
+    }
+    return false;
+}
+
+graphPair GraphColoring::removeSpillNode(){
+    // potential spill: cheapest cost per interference, without
+    // cost info this is the node with the most interference
+    std::string toRemove;
+    double minRatio = 0;
+    bool found = false;
+    for(auto elem : graph){
+        double ratio = nodeCost(elem.first) / std::max<size_t>(elem.second.size(), 1);
+        if(!found || ratio < minRatio){
+            minRatio = ratio;
+            toRemove = elem.first;
+            found = true;
+        }
+    }
+    // a potential spill gives up on its copies
+    dropMoves(toRemove);
+    return unlinkNode(toRemove);
+}
+
+// merged node has fewer than k neighbours of significant degree
+bool GraphColoring::briggsTest(const std::string& u, const std::string& v){
+    std::unordered_set<std::string> neighbours = graph[u];
+    neighbours.insert(graph[v].begin(), graph[v].end());
+    int significant = 0;
+    for(auto t : neighbours){
+        int degree = graph[t].size();
+        if(graph[t].count(u) && graph[t].count(v)){
+            // both edges collapse into one after merging
+            degree--;
+        }
+        if(degree >= totalRegisters){
+            significant++;
+        }
+    }
+    return significant < totalRegisters;
+}
+
+// every neighbour of v already interferes with u or is insignificant
+bool GraphColoring::georgeTest(const std::string& u, const std::string& v){
+    for(auto t : graph[v]){
+        if(graph[t].size() >= totalRegisters && !graph[t].count(u)){
+            return false;
+        }
+    }
+    return true;
+}
+
+void GraphColoring::combine(const std::string& u, const std::string& v){
+    // fold v into u, v takes u's color later
+    alias[v] = u;
+    for(auto t : graph[v]){
+        graph[t].erase(v);
+        graph[t].insert(u);
+        graph[u].insert(t);
+    }
+    graph.erase(v);
+}
+
+bool GraphColoring::coalesceOne(){
+    for(int i = 0; i < moves.size(); ++i){
+        if(pollCancel()){
+            // the caller sees cancelled on its next check
+            return true;
+        }
+        auto u = getAlias(moves[i].first);
+        auto v = getAlias(moves[i].second);
+        if(u == v){
+            // already share a node
+            moves.erase(moves.begin() + i);
+            coalescedMoves++;
+            return true;
+        }
+        if(!graph.count(u) || !graph.count(v) || graph[u].count(v)){
+            // dead copy or interfering pair, can never be coalesced
+            moves.erase(moves.begin() + i);
+            return true;
+        }
+        if(briggsTest(u, v) || georgeTest(u, v)){
+            combine(u, v);
+            moves.erase(moves.begin() + i);
+            coalescedMoves++;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool GraphColoring::freezeOne(){
+    // give up coalescing a low degree node so simplify can take it
+    for(auto elem : graph){
+        if(elem.second.size() < totalRegisters && isMoveRelated(elem.first)){
+            dropMoves(elem.first);
+            return true;
+        }
+    }
+    return false;
 }
 
 void GraphColoring::insertNode(graphPair g){
@@ -41,12 +254,24 @@ void GraphColoring::insertNode(graphPair g){
     // add edge back into graph and check if available color
     graph.insert(g);
     for(auto e : g.second){
-        if(graph.count(e)){
+        // neighbour may have been coalesced after this node was removed
+        auto a = getAlias(e);
+        if(graph.count(a)){
             // edge exists, remove from available reg set
-            registerSet.erase(regMap.at(e));
+            registerSet.erase(regMap.at(a));
         }
     }
-    if(registerSet.size()){
+    if(registerSet.size() && callerSaved){
+        // callee-saved (highest) for values live across a call,
+        // caller-saved (lowest) for the rest
+        bool crossing = crossesCall.count(g.first);
+        int reg = *registerSet.begin();
+        for(auto r : registerSet){
+            reg = crossing ? std::max(reg, r) : std::min(reg, r);
+        }
+        regMap[g.first] = reg;
+    }
+    else if(registerSet.size()){
         // assign available register
         regMap[g.first] = *registerSet.begin();
     }
@@ -57,51 +282,62 @@ void GraphColoring::insertNode(graphPair g){
     }
 }
 
-graphPair GraphColoring::removeOneNode(){
-    // find the first elem that has < register num connects and remove
-    graphPair toRemove;
-    bool found = false;
-    for(auto elem : graph){
-        if(elem.second.size() < totalRegisters){
-            // found our guy
-            toRemove =  elem;
-            found = true;
-            break;
-        }
-    }
-    if(!found){
-        // remove node at random, register as problematic
-        toRemove = *std::next(std::begin(graph), randNum(0, graph.size()-1));
-        // problematic.insert(toRemove.first);
-    }
-
-    // remove from links
-    for(auto v : toRemove.second){
-        graph[v].erase(toRemove.first);
-    }
-    graph.erase(toRemove.first);
-    // std::cout << "remove: " << toRemove.first << std::endl;
-    return toRemove;
-}
-
 void GraphColoring::colorGraph(){
-    // first remove nodes until none left
+    // simplify, coalesce, freeze and spill until no nodes are left
+    if(cancelled){
+        return;
+    }
     std::stack<graphPair> removals;
     while(graph.size()){
-        removals.push(removeOneNode());
+        if(pollCancel()){
+            return;
+        }
+        if(removeOneNode(removals)){
+            continue;
+        }
+        if(coalesceOne() || freezeOne()){
+            continue;
+        }
+        removals.push(removeSpillNode());
     }
 
     // add nodes back in from stack and color
     while(!removals.empty()){
+        if(pollCancel()){
+            return;
+        }
         graphPair toAdd = removals.top();
         removals.pop();
         // std::cout << "add: " << toAdd.first << std::endl;
         insertNode(toAdd);
     }
+    // coalesced nodes share the register of the node they were merged into
+    for(auto elem : alias){
+        regMap[elem.first] = regMap.at(getAlias(elem.first));
+    }
 
+    if(verbose){
+        printResults();
+    }
+}
+
+void GraphColoring::printResults(){
     std::cout << "Graph Coloring Results:" << std::endl;
     for(auto elem : regMap){
+        if(elem.second == -1 && spillCost && spillCost->isRemat(elem.first)){
+            // reloads re-emit the constant instead of touching memory
+            std::cout << elem.first << ": remat " << spillCost->getConstant(elem.first) << std::endl;
+            continue;
+        }
         std::cout << elem.first << ": r" << elem.second << std::endl;
     }
+    std::cout << "Coalesced moves: " << coalescedMoves << std::endl;
+}
 
-}
\ No newline at end of file
+int GraphColoring::getSpillCount(){
+    int spills = 0;
+    for(auto elem : regMap){
+        spills += elem.second == -1;
+    }
+    return spills;
+}
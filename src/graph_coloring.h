@@ -1,20 +1,78 @@
 #pragma once
 #include "cfg.h"
+#include "spill_cost.h"
+#include <atomic>
+#include <functional>
 
 typedef std::pair<std::string, std::unordered_set<std::string>> graphPair;
+// (dest, source) of a copy "x = y"
+typedef std::pair<std::string, std::string> moveInst;
+
+// nodes and edges one block adds to the interference graph: values live
+// out of START interfere with each other, a def with what it is live
+// across (Appel's rule)
+void blockInterference(const CFGNode& block, bool start,
+                       const std::function<void(const std::string&)>& addNode,
+                       const std::function<void(const std::string&, const std::string&)>& addEdge);
+
 class GraphColoring{
     private:
         // std::unordered_set<std::string> problematic;
         std::unordered_map<std::string, int> regMap;
         std::unordered_map<std::string, std::unordered_set<std::string>> graph;
         int totalRegisters;
-        graphPair removeOneNode();
+        const SpillCost* spillCost = nullptr;
+        bool verbose = true;
+        // polled while coloring, once set the allocation is abandoned
+        const std::atomic<bool>* cancelFlag = nullptr;
+        bool cancelled = false;
+        // registers [0, callerSaved) are clobbered by calls, values live
+        // across a call prefer the callee-saved ones above
+        std::unordered_set<std::string> crossesCall;
+        int callerSaved = 0;
+
+        // coalescing state, George/Appel iterated register coalescing
+        std::vector<moveInst> moves;
+        std::unordered_map<std::string, std::string> alias;
+        int coalescedMoves = 0;
+
+        // true once the cancel flag was seen, sets cancelled
+        bool pollCancel();
+        bool removeOneNode(std::stack<graphPair>& removals);
+        graphPair removeSpillNode();
+        graphPair unlinkNode(const std::string& node);
         void insertNode(graphPair g);
+
+        std::string getAlias(const std::string& node);
+        bool isMoveRelated(const std::string& node);
+        void dropMoves(const std::string& node);
+        double nodeCost(const std::string& node);
+        bool briggsTest(const std::string& u, const std::string& v);
+        bool georgeTest(const std::string& u, const std::string& v);
+        void combine(const std::string& u, const std::string& v);
+        bool coalesceOne();
+        bool freezeOne();
     public:
         GraphColoring(int registers): 
             totalRegisters(registers) 
             {};
         
-        void createGraph(std::unordered_map<int, CFGNode*>& cfgBlocks);
+        void setSpillCost(const SpillCost& costs) {spillCost = &costs;};
+        void setVerbose(bool print) {verbose = print;};
+        // on a copy made after createGraph, colors the same graph with k registers
+        void setRegisters(int registers) {totalRegisters = registers;};
+        void setCancelFlag(const std::atomic<bool>& flag) {cancelFlag = &flag;};
+        void setCallInfo(const std::unordered_set<std::string>& crossing, int callerSavedRegs) {
+            crossesCall = crossing;
+            callerSaved = callerSavedRegs;
+        };
+        void createGraph(CompactCFG& cfg);
+        // the graph createGraph built, emptied again by colorGraph
+        const std::unordered_map<std::string, std::unordered_set<std::string>>& getGraph() {return graph;};
         void colorGraph();
-};
\ No newline at end of file
+        void printResults();
+        bool wasCancelled() {return cancelled;};
+        int getCoalescedMoves() {return coalescedMoves;};
+        int getSpillCount();
+        std::unordered_map<std::string, int>& getRegMap() {return regMap;};
+};
@@ -0,0 +1,259 @@
+#include "incremental.h"
+#include "spill_cost.h"
+#include "graph_coloring.h"
+
+std::vector<std::string> IncrementalAllocator::blockSignatures(CompactCFG& cfg){
+    std::vector<std::string> sigs;
+    for(auto& block : cfg.blocks){
+        sigs.push_back(block.astNode ? 
+            nodetype2str(block.astNode->type) + " " + block.astNode->toString() : "");
+    }
+    return sigs;
+}
+
+void IncrementalAllocator::addBlock(const CFGNode& block, bool start, int delta, 
+                                    std::unordered_set<std::string>& dirty){
+    auto addNode = [&](const std::string& v){
+        dirty.insert(v);
+        if((nodeCounts[v] += delta) == 0){
+            nodeCounts.erase(v);
+        }
+    };
+    auto addEdge = [&](const std::string& a, const std::string& z){
+        for(auto& edge : {std::make_pair(a, z), std::make_pair(z, a)}){
+            auto& edges = edgeCounts[edge.first];
+            if((edges[edge.second] += delta) == 0){
+                edges.erase(edge.second);
+            }
+            if(edges.empty()){
+                edgeCounts.erase(edge.first);
+            }
+        }
+    };
+    blockInterference(block, start, addNode, addEdge);
+}
+
+void IncrementalAllocator::fullRun(AstNode* root){
+    cfgCreator = std::make_unique<CFGCreator>();
+    cfgCreator->genCFG(root);
+    auto& cfg = cfgCreator->getCFG();
+    signatures = blockSignatures(cfg);
+
+    LiveOut liveout(cfg);
+    liveout.prepCFG();
+    liveout.computeLiveOut();
+
+    SpillCost spillCost(findRematerializable(root, cfg));
+    spillCost.computeCosts(cfg);
+    GraphColoring graphColoring(totalRegisters);
+    graphColoring.setVerbose(false);
+    graphColoring.setSpillCost(spillCost);
+    graphColoring.createGraph(cfg);
+    graphColoring.colorGraph();
+    regMap = graphColoring.getRegMap();
+
+    edgeCounts.clear();
+    nodeCounts.clear();
+    std::unordered_set<std::string> dirty;
+    for(int i = 0; i < cfg.size(); ++i){
+        addBlock(cfg.blocks[i], i == 0, 1, dirty);
+    }
+    changedStatements = cfg.size();
+    reanalyzedBlocks = cfg.size();
+    recolored = regMap.size();
+}
+
+bool IncrementalAllocator::recolor(const std::unordered_set<std::string>& dirty){
+    recolored = 0;
+    for(auto it = regMap.begin(); it != regMap.end();){
+        // no node left, the variable is gone from the program
+        it = nodeCounts.count(it->first) ? std::next(it) : regMap.erase(it);
+    }
+    for(auto v : dirty){
+        if(!nodeCounts.count(v)) {continue;}
+        std::unordered_set<int> used;
+        if(edgeCounts.count(v)){
+            for(auto elem : edgeCounts[v]){
+                if(regMap.count(elem.first) && regMap[elem.first] != -1){
+                    used.insert(regMap[elem.first]);
+                }
+            }
+        }
+        bool colored = regMap.count(v) && regMap[v] != -1;
+        if(colored && !used.count(regMap[v])){
+            // still no conflict
+            continue;
+        }
+        int reg = 0;
+        while(used.count(reg)){
+            reg++;
+        }
+        if(reg < totalRegisters){
+            regMap[v] = reg;
+            recolored++;
+        }
+        else if(colored || !regMap.count(v)){
+            // needs a real spill decision
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IncrementalAllocator::update(AstNode* root){
+    auto newCreator = std::make_unique<CFGCreator>();
+    newCreator->genCFG(root);
+    auto& cfg = newCreator->getCFG();
+    auto& oldCfg = cfgCreator->getCFG();
+    auto newSignatures = blockSignatures(cfg);
+
+    // statement diff: common prefix and suffix, the middle was edited
+    int n = oldCfg.size();
+    int m = cfg.size();
+    int prefix = 0;
+    while(prefix < n && prefix < m && signatures[prefix] == newSignatures[prefix]){
+        prefix++;
+    }
+    int suffix = 0;
+    while(suffix < n - prefix && suffix < m - prefix 
+        && signatures[n - 1 - suffix] == newSignatures[m - 1 - suffix]){
+        suffix++;
+    }
+    changedStatements = std::max(n - prefix - suffix, m - prefix - suffix);
+    if(changedStatements > maxChangeRatio * m){
+        fullRun(root);
+        return false;
+    }
+
+    std::vector<int> oldOf(m, -1);
+    for(int i = 0; i < m; ++i){
+        if(i < prefix) {oldOf[i] = i;}
+        if(i >= m - suffix) {oldOf[i] = i - m + n;}
+    }
+
+    LiveOut liveout(cfg);
+    liveout.prepCFG();
+
+    // variables touched by the edit may change liveness anywhere upstream
+    std::unordered_set<std::string> suspects;
+    auto addVars = [&](const CFGNode& block){
+        suspects.insert(block.uevar.begin(), block.uevar.end());
+        suspects.insert(block.varkill.begin(), block.varkill.end());
+        if(block.astNode && block.astNode->type == NodeType::VARDECL){
+            suspects.insert(block.astNode->children.at(0)->value);
+        }
+    };
+    std::vector<int> seeds;
+    for(int i = prefix; i < m - suffix; ++i){
+        seeds.push_back(i);
+        addVars(cfg.blocks[i]);
+    }
+    for(int i = prefix; i < n - suffix; ++i){
+        addVars(oldCfg.blocks[i]);
+    }
+    for(int i = 0; i < m; ++i){
+        if(oldOf[i] == -1) {continue;}
+        auto& oldBlock = oldCfg.blocks[oldOf[i]];
+        cfg.blocks[i].liveout = oldBlock.liveout;
+        // unchanged statement whose successors moved into or out of the edit
+        std::unordered_set<int> oldSuccs(oldCfg.successors(oldOf[i]).begin(), oldCfg.successors(oldOf[i]).end());
+        std::unordered_set<int> newSuccs;
+        for(auto s : cfg.successors(i)){
+            newSuccs.insert(oldOf[s]);
+        }
+        if(oldSuccs != newSuccs){
+            seeds.push_back(i);
+            suspects.insert(oldBlock.liveout.begin(), oldBlock.liveout.end());
+        }
+    }
+
+    // drop suspect liveness backwards from the edit, then grow it back
+    std::vector<int> worklist = seeds;
+    std::unordered_set<int> inWorklist(seeds.begin(), seeds.end());
+    for(auto v : suspects){
+        std::vector<int> queue;
+        for(auto s : seeds){
+            cfg.blocks[s].liveout.erase(v);
+            queue.push_back(s);
+        }
+        while(!queue.empty()){
+            int b = queue.back();
+            queue.pop_back();
+            for(auto p : cfg.predecessors(b)){
+                if(cfg.blocks[p].liveout.erase(v)){
+                    queue.push_back(p);
+                    if(inWorklist.insert(p).second){
+                        worklist.push_back(p);
+                    }
+                }
+            }
+        }
+    }
+    for(auto s : seeds){
+        for(auto p : cfg.predecessors(s)){
+            if(inWorklist.insert(p).second){
+                worklist.push_back(p);
+            }
+        }
+    }
+    auto visited = liveout.computeLiveOut(worklist);
+    reanalyzedBlocks = visited.size();
+
+    // swap out the graph share of edited blocks and of blocks whose liveout differs
+    std::unordered_set<std::string> dirty;
+    for(int i = prefix; i < n - suffix; ++i){
+        addBlock(oldCfg.blocks[i], i == 0, -1, dirty);
+    }
+    for(auto b : visited){
+        if(oldOf[b] == -1) {continue;}
+        auto& oldBlock = oldCfg.blocks[oldOf[b]];
+        if(oldBlock.liveout != cfg.blocks[b].liveout){
+            addBlock(oldBlock, b == 0, -1, dirty);
+            addBlock(cfg.blocks[b], b == 0, 1, dirty);
+        }
+    }
+    for(int i = prefix; i < m - suffix; ++i){
+        addBlock(cfg.blocks[i], i == 0, 1, dirty);
+    }
+
+    cfgCreator = std::move(newCreator);
+    signatures = newSignatures;
+    if(!recolor(dirty)){
+        fullRun(root);
+        return false;
+    }
+    return true;
+}
+
+int IncrementalAllocator::countConflicts(){
+    GraphColoring reference(totalRegisters);
+    reference.setVerbose(false);
+    reference.createGraph(cfgCreator->getCFG());
+    auto& graph = reference.getGraph();
+    int conflicts = 0;
+    for(auto& elem : graph){
+        auto it = regMap.find(elem.first);
+        if(it == regMap.end()){
+            conflicts++;
+            continue;
+        }
+        for(auto& neighbour : elem.second){
+            // every edge is seen from both ends, count it once
+            if(elem.first < neighbour && it->second != -1 
+                && regMap.count(neighbour) && regMap.at(neighbour) == it->second){
+                conflicts++;
+            }
+        }
+    }
+    for(auto& elem : regMap){
+        conflicts += !graph.count(elem.first);
+    }
+    return conflicts;
+}
+
+void IncrementalAllocator::printResults(){
+    std::cout << "Incremental Coloring Results:" << std::endl;
+    for(auto elem : regMap){
+        std::cout << elem.first << ": r" << elem.second << std::endl;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <memory>
+#include "cfg.h"
+#include "liveout.h"
+
+// keeps the analysis of the last program around and patches liveness,
+// the interference graph and the coloring after a small edit
+class IncrementalAllocator{
+    private:
+        int totalRegisters;
+        // edited statements, relative to program size, above which a full run is used
+        double maxChangeRatio;
+        std::unique_ptr<CFGCreator> cfgCreator;
+        std::vector<std::string> signatures;
+        // interference graph with the number of blocks backing each edge/node,
+        // so a block's share can be taken out again; built with the same
+        // rule as GraphColoring::createGraph
+        std::unordered_map<std::string, std::unordered_map<std::string, int>> edgeCounts;
+        std::unordered_map<std::string, int> nodeCounts;
+        std::unordered_map<std::string, int> regMap;
+
+        // stats of the last run
+        int changedStatements = 0;
+        int reanalyzedBlocks = 0;
+        int recolored = 0;
+
+        std::vector<std::string> blockSignatures(CompactCFG& cfg);
+        void addBlock(const CFGNode& block, bool start, int delta, 
+                      std::unordered_set<std::string>& dirty);
+        bool recolor(const std::unordered_set<std::string>& dirty);
+    public:
+        IncrementalAllocator(int registers, double maxChangeRatio = 0.25): 
+            totalRegisters(registers),
+            maxChangeRatio(maxChangeRatio)
+            {};
+
+        // analyze and allocate from scratch
+        void fullRun(AstNode* root);
+        // the cfg and the statement diff are redone for the whole program,
+        // liveness, the graph and the coloring only around the edit;
+        // false when the edit was too large and a full run was done instead
+        bool update(AstNode* root);
+        void printResults();
+        // register pairs sharing a register across an edge of the graph a
+        // full GraphColoring run builds for the current program, plus
+        // variables missing from or stale in the coloring; 0 when valid
+        int countConflicts();
+        int getChangedStatements() {return changedStatements;};
+        int getReanalyzedBlocks() {return reanalyzedBlocks;};
+        int getRecolored() {return recolored;};
+};
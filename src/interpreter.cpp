@@ -0,0 +1,280 @@
+#include "interpreter.h"
+
+Interpreter::Interpreter(std::vector<IRInst>& program, CompactCFG& cfg, int registers, int memLatency):
+    program(program),
+    cfg(cfg),
+    totalRegisters(registers),
+    memLatency(memLatency)
+{
+    for(int i = 0; i < program.size(); ++i){
+        if(program[i].op == IR_LABEL){
+            labels[program[i].label] = i;
+        }
+    }
+    for(int b = 0; b < cfg.size(); ++b){
+        liveIn.push_back(getLiveIn(cfg.blocks[b]));
+        if(cfg.blocks[b].astNode){
+            blockOf[cfg.blocks[b].astNode] = b;
+        }
+    }
+}
+
+long Interpreter::evaluate(AstNode* node){
+    switch(node->type){
+        case NodeType::NUM:
+            return std::stol(node->value);
+        case NodeType::VAR:
+            return values[node->value];
+        case NodeType::OP:
+        case NodeType::CMPOP:{
+            long lhs = evaluate(node->children.at(0));
+            long rhs = evaluate(node->children.at(1));
+            if(node->value == "+") {return lhs + rhs;}
+            if(node->value == "-") {return lhs - rhs;}
+            if(node->value == ">") {return lhs > rhs;}
+            return lhs < rhs;
+        }
+        default:
+            // calls are not followed, they return 0
+            return 0;
+    }
+}
+
+long Interpreter::evaluateAllocated(AstNode* node, int block){
+    switch(node->type){
+        case NodeType::NUM:
+            return std::stol(node->value);
+        case NodeType::VAR:{
+            long value = readVar(node->value, block);
+            if(!values.count(node->value)){
+                // read before any def, whatever the location holds is fine
+                values[node->value] = value;
+            }
+            checkValue(node->value, values[node->value], value);
+            return value;
+        }
+        case NodeType::OP:
+        case NodeType::CMPOP:{
+            long lhs = evaluateAllocated(node->children.at(0), block);
+            long rhs = evaluateAllocated(node->children.at(1), block);
+            if(node->value == "+") {return lhs + rhs;}
+            if(node->value == "-") {return lhs - rhs;}
+            if(node->value == ">") {return lhs > rhs;}
+            return lhs < rhs;
+        }
+        case NodeType::CALL:
+            // the arguments are still read
+            for(auto* arg : node->children){
+                evaluateAllocated(arg, block);
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+void Interpreter::checkValue(const std::string& var, long expected, long actual){
+    if(stats.matches && expected != actual){
+        stats.matches = false;
+        stats.mismatch = "ir line " + std::to_string(currentLine) + " read " + var
+            + " = " + std::to_string(actual) + ", expected " + std::to_string(expected);
+    }
+}
+
+long Interpreter::readVar(const std::string& var, int block){
+    int reg = locate(var, 2 * block);
+    if(reg != -1){
+        stats.regAccesses++;
+        return regFile[reg];
+    }
+    if(spillCost && spillCost->isRemat(var)){
+        stats.remats++;
+        return std::stol(spillCost->getConstant(var));
+    }
+    stats.loads++;
+    return memory[var];
+}
+
+void Interpreter::writeVar(const std::string& var, long value, int block){
+    if(!cfg.blocks[block].liveout.count(var)){
+        // dead def, computed into a scratch register and dropped
+        stats.regAccesses++;
+        return;
+    }
+    int reg = locate(var, 2 * block + 1);
+    if(reg != -1){
+        stats.regAccesses++;
+        regFile[reg] = value;
+        heldReg[var] = reg;
+        inMemory.erase(var);
+        return;
+    }
+    heldReg[var] = -1;
+    if(spillCost && spillCost->isRemat(var)){
+        // the constant is re-emitted at every use, nothing to store
+        inMemory.erase(var);
+        return;
+    }
+    stats.stores++;
+    memory[var] = value;
+    inMemory.insert(var);
+}
+
+void Interpreter::transfer(const std::vector<std::pair<std::string, int>>& targets){
+    // read every source before writing any destination
+    std::vector<std::pair<std::string, int>> pending;
+    std::vector<long> sources;
+    for(auto& target : targets){
+        auto& var = target.first;
+        bool remat = spillCost && spillCost->isRemat(var);
+        int held = heldReg.count(var) ? heldReg[var] : -1;
+        if(target.second == -1 && (inMemory.count(var) || remat)){
+            // already has its memory copy, the register is free to reuse
+            heldReg[var] = -1;
+            continue;
+        }
+        if(target.second != -1 && held == target.second){
+            continue;
+        }
+        if(held != -1){
+            sources.push_back(regFile[held]);
+        }
+        else if(inMemory.count(var)){
+            sources.push_back(memory[var]);
+        }
+        else if(remat){
+            sources.push_back(std::stol(spillCost->getConstant(var)));
+        }
+        else{
+            // never written on this path, its value is undefined
+            sources.push_back(0);
+        }
+        pending.push_back(target);
+    }
+    for(int i = 0; i < pending.size(); ++i){
+        auto& var = pending[i].first;
+        int reg = pending[i].second;
+        int held = heldReg.count(var) ? heldReg[var] : -1;
+        if(reg == -1){
+            stats.stores++;
+            memory[var] = sources[i];
+            inMemory.insert(var);
+        }
+        else{
+            if(held != -1) {stats.moves++;}
+            else if(inMemory.count(var)) {stats.loads++;}
+            else {stats.remats++;}
+            regFile[reg] = sources[i];
+        }
+        heldReg[var] = reg;
+    }
+}
+
+void Interpreter::enterBlock(int block){
+    std::vector<std::pair<std::string, int>> targets;
+    for(auto& v : liveIn[block]){
+        targets.push_back(std::make_pair(v, locate(v, 2 * block)));
+    }
+    transfer(targets);
+}
+
+void Interpreter::leaveBlock(int block, const std::string& def){
+    // values live through the block, the def is written in place afterwards
+    std::vector<std::pair<std::string, int>> targets;
+    for(auto& v : cfg.blocks[block].liveout){
+        if(v != def){
+            targets.push_back(std::make_pair(v, locate(v, 2 * block + 1)));
+        }
+    }
+    transfer(targets);
+}
+
+ExecStats Interpreter::run(locateFn locateVar){
+    locate = locateVar;
+    stats = ExecStats();
+    values.clear();
+    regFile.assign(totalRegisters, 0);
+    memory.clear();
+    heldReg.clear();
+    inMemory.clear();
+
+    // variables read before any def are undefined, their locations start at 0
+    for(auto v : cfg.blocks[0].liveout){
+        int reg = locate(v, 1);
+        heldReg[v] = reg;
+        if(reg == -1){
+            memory[v] = 0;
+            inMemory.insert(v);
+        }
+    }
+
+    int pc = 0;
+    while(pc < program.size()){
+        if(stats.instructions >= maxSteps){
+            stats.finished = false;
+            break;
+        }
+        auto& inst = program[pc];
+        currentLine = pc;
+        if(inst.op == IR_LABEL){
+            pc++;
+            continue;
+        }
+        stats.instructions++;
+        if(inst.op == IR_JUMP){
+            pc = labels.at(inst.label);
+            continue;
+        }
+        int block = blockOf.at(inst.node);
+        enterBlock(block);
+        if(inst.op == IR_ASSIGN){
+            auto def = inst.node->children.at(0)->value;
+            long value = evaluateAllocated(inst.node->children.at(1), block);
+            long expected = evaluate(inst.node->children.at(1));
+            leaveBlock(block, def);
+            values[def] = expected;
+            writeVar(def, value, block);
+            pc++;
+            continue;
+        }
+        if(inst.op == IR_RETURN){
+            long value = evaluateAllocated(inst.node->children.at(0), block);
+            checkValue("return value", evaluate(inst.node->children.at(0)), value);
+            break;
+        }
+        // branch, taken when the condition is false
+        long value = evaluateAllocated(inst.node->children.at(0), block);
+        long expected = evaluate(inst.node->children.at(0));
+        checkValue("condition", expected, value);
+        leaveBlock(block, "");
+        pc = expected ? pc + 1 : labels.at(inst.label);
+    }
+
+    stats.cycles = stats.instructions + stats.moves + stats.remats
+        + (stats.loads + stats.stores) * memLatency;
+    return stats;
+}
+
+ExecStats Interpreter::run(const std::unordered_map<std::string, int>& regMap){
+    return run([&](const std::string& var, int position){
+        auto it = regMap.find(var);
+        return it == regMap.end() ? -1 : it->second;
+    });
+}
+
+void printExecStats(const std::string& name, const ExecStats& stats){
+    std::cout << name << ": " << stats.instructions << " instructions, "
+              << stats.regAccesses << " register accesses, "
+              << stats.loads << " loads, " << stats.stores << " stores, "
+              << stats.moves << " moves, " << stats.remats << " remats, "
+              << stats.cycles << " cycles";
+    if(!stats.finished){
+        std::cout << " (step limit reached)";
+    }
+    if(stats.matches){
+        std::cout << ", matches reference" << std::endl;
+    }
+    else{
+        std::cout << ", MISMATCH: " << stats.mismatch << std::endl;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "linear_scan.h"
+#include "spill_cost.h"
+
+// dynamic counts of one allocated execution
+struct ExecStats{
+    long instructions = 0;
+    long regAccesses = 0;
+    long loads = 0;
+    long stores = 0;
+    // register to register copies where the allocation moved a value
+    long moves = 0;
+    // spilled constants re-emitted as immediates
+    long remats = 0;
+    long cycles = 0;
+    // false once a read or branch saw a different value than the reference
+    bool matches = true;
+    std::string mismatch;
+    // false when the step limit cut the run short
+    bool finished = true;
+};
+
+// executes the ir twice in lockstep, once on plain variables (the reference)
+// and once on a machine with k registers and a spill slot per variable laid
+// out by an allocation, every value the allocated run reads is checked
+// against the reference
+class Interpreter{
+    private:
+        std::vector<IRInst>& program;
+        CompactCFG& cfg;
+        int totalRegisters;
+        // cycles per spill load/store, every other instruction or move is one
+        int memLatency;
+        long maxSteps = 1000000;
+        const SpillCost* spillCost = nullptr;
+
+        std::unordered_map<std::string, int> labels;
+        std::unordered_map<AstNode*, int> blockOf;
+        std::vector<std::unordered_set<std::string>> liveIn;
+
+        // reference state
+        std::unordered_map<std::string, long> values;
+        // allocated state, where each variable's current value is held
+        std::vector<long> regFile;
+        std::unordered_map<std::string, long> memory;
+        std::unordered_map<std::string, int> heldReg;
+        std::unordered_set<std::string> inMemory;
+        locateFn locate;
+        ExecStats stats;
+        int currentLine = 0;
+
+        long evaluate(AstNode* node);
+        long evaluateAllocated(AstNode* node, int block);
+        long readVar(const std::string& var, int block);
+        void writeVar(const std::string& var, long value, int block);
+        // move every (var, register) pair to where the allocation has it,
+        // as one parallel copy so swaps do not clobber each other
+        void transfer(const std::vector<std::pair<std::string, int>>& targets);
+        void enterBlock(int block);
+        void leaveBlock(int block, const std::string& def);
+        void checkValue(const std::string& var, long expected, long actual);
+    public:
+        Interpreter(std::vector<IRInst>& program, CompactCFG& cfg, int registers, int memLatency);
+
+        void setSpillCost(const SpillCost& costs) {spillCost = &costs;};
+        void setMaxSteps(long steps) {maxSteps = steps;};
+        // run the program with every variable where locate puts it
+        ExecStats run(locateFn locate);
+        // same for allocations with one register (or -1) per variable
+        ExecStats run(const std::unordered_map<std::string, int>& regMap);
+};
+
+void printExecStats(const std::string& name, const ExecStats& stats);
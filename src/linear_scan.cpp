@@ -1,4 +1,6 @@
 #include "linear_scan.h"
+#include <set>
+#include <algorithm>
 
 void IRManager::generateIR(AstNode* node, std::ofstream& file){
     if(node->type == NodeType::ROOT || node->type == NodeType::STAT_LIST){
@@ -11,7 +13,17 @@ void IRManager::generateIR(AstNode* node, std::ofstream& file){
         varlist defs = {node->children.at(0)->value};
         varlist uses = getUEVar(node->children.at(1));
         file << node->toString() << std::endl;
+        irInsts.push_back({IR_ASSIGN, node, ""});
         irVarData.push_back(std::make_tuple(lineno, defs, uses));
+        irLineNodes[lineno] = node;
+        lineno++;
+    }
+    else if(node->type == NodeType::RETURN){
+        varlist uses = getUEVar(node->children.at(0));
+        file << node->toString() << std::endl;
+        irInsts.push_back({IR_RETURN, node, ""});
+        irVarData.push_back(std::make_tuple(lineno, varlist(), uses));
+        irLineNodes[lineno] = node;
         lineno++;
     }
     else if(node->type == NodeType::IF){
@@ -19,9 +31,11 @@ void IRManager::generateIR(AstNode* node, std::ofstream& file){
         branchNum += 1;
         file << "if not " << node->children.at(0)->toString();
         file << " goto else_" << myBranchNum << std::endl;
+        irInsts.push_back({IR_BRANCH, node, "else_" + std::to_string(myBranchNum)});
 
         varlist uses = getUEVar(node->children.at(0));
         irVarData.push_back(std::make_tuple(lineno, varlist(), uses));
+        irLineNodes[lineno] = node;
         lineno++;
 
         // true case emit
@@ -29,10 +43,12 @@ void IRManager::generateIR(AstNode* node, std::ofstream& file){
 
         // emit jump to end
         file << "goto if_" << myBranchNum << "_end" << std::endl;
+        irInsts.push_back({IR_JUMP, nullptr, "if_" + std::to_string(myBranchNum) + "_end"});
         lineno++;
 
         // emit else label
         file << "else_" << myBranchNum << ":" << std::endl;
+        irInsts.push_back({IR_LABEL, nullptr, "else_" + std::to_string(myBranchNum)});
         lineno++;
 
         // resolve else case if exists
@@ -41,124 +57,275 @@ void IRManager::generateIR(AstNode* node, std::ofstream& file){
         }
         // emit end if statement
         file << "if_" << myBranchNum << "_end:" << std::endl;
+        irInsts.push_back({IR_LABEL, nullptr, "if_" + std::to_string(myBranchNum) + "_end"});
         lineno++;
     }
     else if(node->type == NodeType::WHILE){
         int myBranchNum = branchNum;
         branchNum += 1;
         file << "while_" << myBranchNum << ":" << std::endl;
+        irInsts.push_back({IR_LABEL, nullptr, "while_" + std::to_string(myBranchNum)});
         lineno++;
 
         file << "if not " << node->children.at(0)->toString();
         file << " goto while_end_" << myBranchNum << std::endl;
+        irInsts.push_back({IR_BRANCH, node, "while_end_" + std::to_string(myBranchNum)});
 
         varlist uses = getUEVar(node->children.at(0));
         irVarData.push_back(std::make_tuple(lineno, varlist(), uses));
+        irLineNodes[lineno] = node;
         lineno++;
 
         // resolve body
         generateIR(node->children.at(1), file);
         // emit loop statement
         file << "goto while_" << myBranchNum << std::endl;
+        irInsts.push_back({IR_JUMP, nullptr, "while_" + std::to_string(myBranchNum)});
         lineno++;
         file << "while_end_" << myBranchNum << ":" << std::endl;
+        irInsts.push_back({IR_LABEL, nullptr, "while_end_" + std::to_string(myBranchNum)});
         lineno++;
 
     }
 }
 
 
-void LinearScan::computeIntervals(std::vector<execStepData>& irVarData){
-    
-    for(auto execElem : irVarData){
-        int execNum = std::get<0>(execElem);
-        for(auto def : std::get<1>(execElem)){
-            if(!liveIntervals.count(def)){
-                liveIntervals[def] = std::make_pair(execNum, 0);
+void LinearScan::computeIntervals(CompactCFG& blocks){
+    cfg = &blocks;
+    // positions each variable is live at, in increasing order
+    std::unordered_map<std::string, std::vector<int>> positions;
+    for(int b = 0; b < blocks.size(); ++b){
+        if(cancelFlag && cancelFlag->load(std::memory_order_relaxed)){
+            cancelled = true;
+            return;
+        }
+        auto& cfgNode = blocks.blocks[b];
+        for(auto v : getLiveIn(cfgNode)){
+            positions[v].push_back(2 * b);
+        }
+        auto out = cfgNode.liveout;
+        if(cfgNode.astNode && cfgNode.astNode->type == NodeType::VARDECL){
+            out.insert(cfgNode.astNode->children.at(0)->value);
+        }
+        for(auto v : out){
+            positions[v].push_back(2 * b + 1);
+        }
+        if(cfgNode.astNode && cfgNode.astNode->type == NodeType::WHILE){
+            // body blocks follow the header, the back edges come from its end
+            int loopEnd = b;
+            for(auto p : blocks.predecessors(b)){
+                loopEnd = std::max(loopEnd, p);
             }
-            if(liveIntervals[def].second < execNum){
-                liveIntervals[def].second = execNum;
+            loopBoundaries.push_back(2 * b);
+            loopBoundaries.push_back(2 * loopEnd + 2);
+        }
+    }
+
+    for(auto elem : positions){
+        auto& intervals = liveIntervals[elem.first];
+        for(auto pos : elem.second){
+            if(intervals.size() && intervals.back().second == pos - 1){
+                intervals.back().second = pos;
+            }
+            else{
+                intervals.push_back(std::make_pair(pos, pos));
             }
         }
-        for(auto use : std::get<2>(execElem)){
-            if(liveIntervals[use].second < execNum){
-                liveIntervals[use].second = execNum;
+        // loops get their own piece so the rest of the range can be spilled
+        for(auto interval : intervals){
+            int start = interval.first;
+            for(auto boundary : loopBoundaries){
+                if(boundary > start && boundary <= interval.second){
+                    ranges.push_back({elem.first, start, boundary - 1, -1});
+                    start = boundary;
+                }
             }
+            ranges.push_back({elem.first, start, interval.second, -1});
         }
     }
+    std::sort(ranges.begin(), ranges.end(), [](const LiveRange& a, const LiveRange& b){
+        return a.start != b.start ? a.start < b.start : a.var < b.var;
+    });
+
+    if(!verbose) {return;}
     std::cout << "Live Intervals:" << std::endl;
     for(auto elem : liveIntervals){
-        std::cout << elem.first 
-                  << ": [" << elem.second.first
-                  << ", " 
-                  << elem.second.second 
-                  << "]"
-                  << std::endl;
-        
-    }
-    execSteps = std::get<0>(irVarData[irVarData.size()-1]);
+        std::cout << elem.first << ":";
+        for(auto interval : elem.second){
+            std::cout << " [" << interval.first << ", " << interval.second << "]";
+        }
+        std::cout << std::endl;
+    }
+}
+
+double LinearScan::rangeCost(const std::string& var, int start, int end){
+    // without costs every piece is equal, ties spill the furthest end
+    return spillCost ? spillCost->getRangeCost(var, start, end) : 1;
 }
 
 void LinearScan::allocateRegisters(){
-    std::unordered_map<std::string, int> inUseRegs;
-    std::unordered_set<int> availableRegs;
+    if(cancelled){
+        return;
+    }
+    std::vector<int> active;
+    std::set<int> availableRegs;
+    std::unordered_map<std::string, int> lastReg;
     for(int i = 0; i < maxRegisters; ++i){
         availableRegs.insert(i);
     }
-    // loop through each execution step
-    for(int lineno = 0; lineno <= execSteps; ++lineno){
-        // check who needs what
-        std::vector<std::string> toAssign;
-        std::vector<std::string> toExpire;
-        for(auto varElem : liveIntervals){
-            auto varName = varElem.first;
-            auto liveInterval = varElem.second;
-            if(liveInterval.second == lineno){
-                toExpire.push_back(varName);
+    // split tails are appended and stay in memory, only walk the originals
+    int rangeCount = ranges.size();
+    for(int i = 0; i < rangeCount; ++i){
+        if(cancelFlag && cancelFlag->load(std::memory_order_relaxed)){
+            cancelled = true;
+            return;
+        }
+        auto var = ranges[i].var;
+        int start = ranges[i].start;
+        // expire pieces that ended before this one starts
+        std::vector<int> stillActive;
+        for(auto a : active){
+            if(ranges[a].end < start){
+                availableRegs.insert(ranges[a].reg);
             }
-            if(liveInterval.first == lineno){
-                toAssign.push_back(varName);
+            else{
+                stillActive.push_back(a);
             }
         }
-        // expire nodes first:
-        for(auto v : toExpire){
-            inUseRegs.erase(v);
-            availableRegs.insert(regMap[v]);
-        }
-        for(auto v : toAssign){
-            // assign register
-            if(inUseRegs.size() < maxRegisters){
-                int regNum = *availableRegs.begin();
-                regMap[v] = regNum;
-                inUseRegs[v] = regNum;
-                availableRegs.erase(regMap[v]);
+        active = stillActive;
+
+        int regNum;
+        if(availableRegs.size()){
+            // keep the register of the previous piece to avoid a move
+            regNum = lastReg.count(var) && availableRegs.count(lastReg[var]) ? 
+                lastReg[var] : *availableRegs.begin();
+            availableRegs.erase(regNum);
+        }
+        else{
+            // no registers available, evict the cheapest remainder
+            // (the new piece included), ties by furthest end
+            int evict = i;
+            double minCost = rangeCost(var, start, ranges[i].end);
+            for(auto a : active){
+                double cost = rangeCost(ranges[a].var, start, ranges[a].end);
+                if(cost < minCost || (cost == minCost && ranges[a].end > ranges[evict].end)){
+                    minCost = cost;
+                    evict = a;
+                }
+            }
+            if(evict == i){
+                continue;
+            }
+            regNum = ranges[evict].reg;
+            if(ranges[evict].start < start){
+                // split, the part already allocated keeps its register
+                ranges.push_back({ranges[evict].var, start, ranges[evict].end, -1});
+                ranges[evict].end = start - 1;
+                splitCount++;
             }
             else{
-                // no registers available
-                // spill a node using a register
-                // decided by min total range
-                std::string spillVar = "";
-                int minRange = execSteps;
-                for(auto elem : inUseRegs){
-                    int range = liveIntervals[elem.first].second - 
-                        liveIntervals[elem.first].first;
-                    if(range < minRange){
-                        minRange = range;
-                        spillVar = elem.first;
-                    }
-                }
-                // mark spilled in overall allocation
-                regMap[spillVar] = -1;
+                ranges[evict].reg = -1;
+            }
+            active.erase(std::find(active.begin(), active.end(), evict));
+        }
+        ranges[i].reg = regNum;
+        lastReg[var] = regNum;
+        active.push_back(i);
+    }
 
-                // remove from currently in use and 
-                // give up register number
-                inUseRegs.erase(spillVar);
-                inUseRegs[v] = inUseRegs[spillVar];
+    std::sort(ranges.begin(), ranges.end(), [](const LiveRange& a, const LiveRange& b){
+        return a.start != b.start ? a.start < b.start : a.var < b.var;
+    });
+    for(int i = 0; i < ranges.size(); ++i){
+        varRanges[ranges[i].var].push_back(i);
+    }
+    // register of the first piece, -1 once any piece lives in memory
+    for(auto elem : varRanges){
+        int reg = ranges[elem.second[0]].reg;
+        for(auto r : elem.second){
+            if(ranges[r].reg == -1){
+                reg = -1;
             }
         }
+        regMap[elem.first] = reg;
+    }
+    countResolutionMoves();
+
+    if(verbose){
+        printResults();
     }
+}
+
+void LinearScan::printResults(){
     std::cout << "Linear Scan Results:" << std::endl;
+    for(auto elem : varRanges){
+        std::cout << elem.first << ": ";
+        bool sameReg = true;
+        for(auto r : elem.second){
+            sameReg = sameReg && ranges[r].reg == ranges[elem.second[0]].reg;
+        }
+        if(sameReg){
+            std::cout << location(elem.first, ranges[elem.second[0]].reg) << std::endl;
+            continue;
+        }
+        for(int i = 0; i < elem.second.size(); ++i){
+            auto& range = ranges[elem.second[i]];
+            std::cout << (i ? ", " : "") << location(elem.first, range.reg) 
+                      << " [" << range.start << ", " << range.end << "]";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "Split intervals: " << splitCount 
+              << ", resolution moves: " << resolutionMoves << std::endl;
+}
+
+std::string LinearScan::location(const std::string& var, int reg){
+    if(reg == -1 && spillCost && spillCost->isRemat(var)){
+        // reloads re-emit the constant instead of touching memory
+        return "remat " + spillCost->getConstant(var);
+    }
+    return "r" + std::to_string(reg);
+}
+
+int LinearScan::locate(const std::string& var, int position){
+    if(!varRanges.count(var)){
+        return -1;
+    }
+    for(auto r : varRanges.at(var)){
+        if(ranges[r].start <= position && position <= ranges[r].end){
+            return ranges[r].reg;
+        }
+    }
+    return -1;
+}
+
+void LinearScan::countResolutionMoves(){
+    // a value changing location inside a block or along a cfg edge
+    // needs a move, load or store there
+    for(int b = 0; b < cfg->size(); ++b){
+        auto& cfgNode = cfg->blocks[b];
+        auto in = getLiveIn(cfgNode);
+        for(auto v : cfgNode.liveout){
+            bool defined = cfgNode.astNode && cfgNode.astNode->type == NodeType::VARDECL 
+                && cfgNode.astNode->children.at(0)->value == v;
+            if(in.count(v) && !defined && locate(v, 2 * b) != locate(v, 2 * b + 1)){
+                resolutionMoves++;
+            }
+        }
+        for(auto child : cfg->successors(b)){
+            for(auto v : getLiveIn(cfg->blocks[child])){
+                if(locate(v, 2 * b + 1) != locate(v, 2 * child)){
+                    resolutionMoves++;
+                }
+            }
+        }
+    }
+}
+
+int LinearScan::getSpillCount(){
+    int spills = 0;
     for(auto elem : regMap){
-        std::cout << elem.first << ": r" << elem.second << std::endl;
+        spills += elem.second == -1;
     }
-}
\ No newline at end of file
+    return spills;
+}
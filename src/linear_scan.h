@@ -1,16 +1,39 @@
 #pragma once
 #include "ast.h"
 #include "liveout.h"
+#include "spill_cost.h"
+#include <atomic>
 
 // traverse ast to create ir
 typedef std::unordered_set<std::string> varlist;
 
 // exec lineno, var defines, var usages
 typedef std::tuple<int, varlist, varlist> execStepData;
+
+// kinds of ir lines, a branch is "if not <cond> goto <label>"
+enum IROp{
+    IR_ASSIGN,
+    IR_BRANCH,
+    IR_JUMP,
+    IR_LABEL,
+    IR_RETURN
+};
+
+// one line of the ir, node is the statement for assigns, branches and returns,
+// label is the jump target or the label being defined
+struct IRInst{
+    IROp op;
+    AstNode* node;
+    std::string label;
+};
 class IRManager{
     private:
         // tracks <defines, usages> line by line for ir
         std::vector<execStepData> irVarData;
+        // statement each ir line with var data came from
+        std::unordered_map<int, AstNode*> irLineNodes;
+        // the emitted ir, one entry per line
+        std::vector<IRInst> irInsts;
 
         // upwards growing branch number
         int branchNum = 0;
@@ -23,16 +46,55 @@ class IRManager{
         std::vector<execStepData>& getIrVarData() {
             return irVarData;
         }
+        std::unordered_map<int, AstNode*>& getIrLineNodes() {
+            return irLineNodes;
+        }
+        std::vector<IRInst>& getIrInsts() {
+            return irInsts;
+        }
+};
+
+// piece of a live interval, positions are 2*block (block entry, reads
+// its uses) and 2*block+1 (block exit, holds its def)
+struct LiveRange{
+    std::string var;
+    int start;
+    int end;
+    int reg;
 };
 
 class LinearScan{
     public:
         std::unordered_map<std::string, int> regMap;
-        std::unordered_map<std::string, std::pair<int, int>> liveIntervals;
+        // cfg liveness per variable, lifetime holes between the ranges
+        std::unordered_map<std::string, std::vector<std::pair<int, int>>> liveIntervals;
+        // allocated pieces after splitting at loop boundaries and on spills
+        std::vector<LiveRange> ranges;
+        std::unordered_map<std::string, std::vector<int>> varRanges;
+        // positions where a while loop is entered or left
+        std::vector<int> loopBoundaries;
+        CompactCFG* cfg = nullptr;
         int maxRegisters;
-        int execSteps;
+        int splitCount = 0;
+        int resolutionMoves = 0;
+        const SpillCost* spillCost = nullptr;
+        bool verbose = true;
+        // polled between ranges, once set the allocation is abandoned
+        const std::atomic<bool>* cancelFlag = nullptr;
+        bool cancelled = false;
 
         LinearScan(int registers): maxRegisters(registers) {};
-        void computeIntervals(std::vector<execStepData>& irVarData);
+        void setSpillCost(const SpillCost& costs) {spillCost = &costs;};
+        void setVerbose(bool print) {verbose = print;};
+        void setCancelFlag(const std::atomic<bool>& flag) {cancelFlag = &flag;};
+        void computeIntervals(CompactCFG& cfg);
         void allocateRegisters();
-};
\ No newline at end of file
+        void printResults();
+        // register holding var at a linear position, -1 in memory
+        int locate(const std::string& var, int position);
+        int getSpillCount();
+    private:
+        double rangeCost(const std::string& var, int start, int end);
+        void countResolutionMoves();
+        std::string location(const std::string& var, int reg);
+};
@@ -1,16 +1,16 @@
 #include "liveout.h"
 
 
-std::unordered_set<std::string> LiveOut::singleLiveOut(CFGNode* node){
-    std::unordered_set<std::string> ret = node->uevar;
+std::unordered_set<std::string> LiveOut::singleLiveOut(const CFGNode& node){
+    std::unordered_set<std::string> ret = node.uevar;
     std::unordered_set<std::string> nvarkill = varDomain;
     // compute nvarkill
-    for(auto v : node->varkill){
+    for(auto v : node.varkill){
         nvarkill.erase(v);
     }
     // n.uevar | (n.liveout & n.nvarkill)
     for(auto v : nvarkill){
-        if(node->liveout.count(v)){
+        if(node.liveout.count(v)){
             // intersection
             ret.insert(v);
         }
@@ -18,21 +18,22 @@ std::unordered_set<std::string> LiveOut::singleLiveOut(CFGNode* node){
     return ret;
 }
 
-bool LiveOut::updateLiveOut(CFGNode* node){
-    auto old = node->liveout;
-    for(auto* cn : node->children){
-        for(auto v : singleLiveOut(cn)){
-            node->liveout.insert(v);
+bool LiveOut::updateLiveOut(int id){
+    auto& node = cfg.blocks[id];
+    auto old = node.liveout;
+    for(auto cn : cfg.successors(id)){
+        for(auto v : singleLiveOut(cfg.blocks[cn])){
+            node.liveout.insert(v);
         }
     }
 
-    // std::cout << node->id << ": ";
-    // for(auto v : node->liveout){
+    // std::cout << id << ": ";
+    // for(auto v : node.liveout){
     //     std::cout << v << ", ";
     // }
     // std::cout << std::endl;
 
-    return old != node->liveout;
+    return old != node.liveout;
 
 }
 
@@ -40,12 +41,27 @@ void LiveOut::computeLiveOut(){
     bool changed = true;
     while(changed){
         changed = false;
-        for(int i = cfgBlocks.size()-1; i >= 0; --i){
-            changed = changed | updateLiveOut(cfgBlocks[i]);
+        for(int i = cfg.size()-1; i >= 0; --i){
+            changed = changed | updateLiveOut(i);
         }
     }
 }
 
+std::unordered_set<int> LiveOut::computeLiveOut(std::vector<int> worklist){
+    std::unordered_set<int> visited;
+    while(!worklist.empty()){
+        int id = worklist.back();
+        worklist.pop_back();
+        visited.insert(id);
+        if(updateLiveOut(id)){
+            for(auto p : cfg.predecessors(id)){
+                worklist.push_back(p);
+            }
+        }
+    }
+    return visited;
+}
+
 std::unordered_set<std::string> getUEVar(AstNode* node){
     std::unordered_set<std::string> uevar;
     if(node->children.size()){
@@ -61,34 +77,44 @@ std::unordered_set<std::string> getUEVar(AstNode* node){
     return uevar;
 }
 
+std::unordered_set<std::string> getLiveIn(const CFGNode& node){
+    std::unordered_set<std::string> livein = node.uevar;
+    for(auto v : node.liveout){
+        if(!node.varkill.count(v)){
+            livein.insert(v);
+        }
+    }
+    return livein;
+}
+
 void LiveOut::prepCFG(){
-    for(int i = 0; i < cfgBlocks.size(); ++i){
-        auto* cfgNode = cfgBlocks[i];
-        auto* astNode = cfgNode->astNode;
+    for(int i = 0; i < cfg.size(); ++i){
+        auto& cfgNode = cfg.blocks[i];
+        auto* astNode = cfgNode.astNode;
         if(!astNode) {continue;}
         // compute uevar and livevar
         if(astNode->type == NodeType::VARDECL){
             
             // resolve expr for uevar:
             for(auto u : getUEVar(astNode->children[1])){
-                cfgNode->uevar.insert(u);
+                cfgNode.uevar.insert(u);
                 varDomain.insert(u);
             }
             
-            if(!cfgNode->uevar.count(astNode->children[0]->value)){
+            if(!cfgNode.uevar.count(astNode->children[0]->value)){
                 // lhs is part of varkill, only add if not using in rhs
-                cfgNode->varkill.insert(astNode->children[0]->value);
+                cfgNode.varkill.insert(astNode->children[0]->value);
                 varDomain.insert(astNode->children[0]->value);
             }
 
         }
-        else if(astNode->type == NodeType::IF || astNode->type == NodeType::WHILE){
-            // for if/while only eval expr for uevar
+        else if(astNode->type == NodeType::IF || astNode->type == NodeType::WHILE
+            || astNode->type == NodeType::RETURN){
+            // for if/while/return only eval expr for uevar
              for(auto u : getUEVar(astNode->children[0])){
-                cfgNode->uevar.insert(u);
+                cfgNode.uevar.insert(u);
                 varDomain.insert(u);
             }
         }
     }
-    std::cout << std::endl;
 }
\ No newline at end of file
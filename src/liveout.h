@@ -5,18 +5,23 @@
 
 // grab all used variables from a ast node
 std::unordered_set<std::string> getUEVar(AstNode* node);
+// n.uevar | (n.liveout - n.varkill), needs computeLiveOut first
+std::unordered_set<std::string> getLiveIn(const CFGNode& node);
 
 class LiveOut{
     private:
         std::unordered_set<std::string> varDomain;
-        std::unordered_map<int, CFGNode*>& cfgBlocks;
+        CompactCFG& cfg;
 
-        std::unordered_set<std::string> singleLiveOut(CFGNode* node);
-        bool updateLiveOut(CFGNode* node);
+        std::unordered_set<std::string> singleLiveOut(const CFGNode& node);
+        bool updateLiveOut(int id);
     public:
-        LiveOut(std::unordered_map<int, CFGNode*>& blocks): cfgBlocks(blocks) {};
+        LiveOut(CompactCFG& cfg): cfg(cfg) {};
         
         void prepCFG();
         void computeLiveOut();
+        // worklist liveness from the given blocks, blocks never reached keep
+        // their current liveout, returns every block visited
+        std::unordered_set<int> computeLiveOut(std::vector<int> worklist);
         
 };
\ No newline at end of file
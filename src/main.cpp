@@ -2,6 +2,7 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <chrono>
 
 // ANTLR4 Runtime
 #include "antlr4-runtime.h"
@@ -16,8 +17,20 @@
 #include "ast.h"
 #include "cfg.h"
 #include "liveout.h"
+#include "spill_cost.h"
 #include "graph_coloring.h"
 #include "linear_scan.h"
+#include "ssa.h"
+#include "chordal_coloring.h"
+#include "profile.h"
+#include "incremental.h"
+#include "interpreter.h"
+#include "portfolio.h"
+#include "functions.h"
+#include "three_address.h"
+#include "cleanup.h"
+#include "sweep.h"
+#include "tiered.h"
 
 using namespace antlrcpp;
 using namespace antlr4;
@@ -39,16 +52,9 @@ std::string readf(const std::string& src_file)
 	return buffer.str();
 }
 
-int main(int argc, char *argv[])
-{	
-	if (argc != 3) {
-		std::cerr << "Incorrect arguments\nusage: ./reg_alloc <src_file> <#registers>" << std::endl;
-		exit(EXIT_FAILURE);
-	}
-
-	std::string src_code = readf(argv[1]);
-	std::string inFileName = std::string(argv[1]);
-	int registerCount = atoi(argv[2]);
+AstNode* parseProgram(const std::string& src_code);
+AstNode* parseProgram(const std::string& src_code)
+{
 	ANTLRInputStream input(src_code);
 	
 	// Lexer`
@@ -80,35 +86,351 @@ int main(int argc, char *argv[])
 	tree::ParseTreeWalker walker;
 	walker.walk(&simpleAst, tree);
 
-	AstNode* root = simpleAst.getAst();
+	return simpleAst.getAst();
+}
+
+long elapsedMicros(std::chrono::steady_clock::time_point start);
+long elapsedMicros(std::chrono::steady_clock::time_point start)
+{
+	auto elapsed = std::chrono::steady_clock::now() - start;
+	return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void printTrafficSaved(const std::string& name, std::pair<double, double> unprofiled, std::pair<double, double> profiled);
+void printTrafficSaved(const std::string& name, std::pair<double, double> unprofiled, std::pair<double, double> profiled)
+{
+	std::cout << name << ": "
+			  << unprofiled.first << " loads / " << unprofiled.second << " stores unprofiled, "
+			  << profiled.first << " / " << profiled.second << " profiled, saved "
+			  << unprofiled.first - profiled.first << " / " 
+			  << unprofiled.second - profiled.second << std::endl;
+}
+
+int main(int argc, char *argv[])
+{	
+	const char* usage = "usage: ./reg_alloc <src_file> <#registers> [--ssa] [--profile <file>] [--incremental <edited_src_file>]... [--interpret <mem_latency>] [--portfolio] [--portfolio-threshold <cost>] [--threads <n>] [--three-address] [--cleanup] [--sweep <min_registers> <max_registers>] [--budget <micros>]";
+	if (argc < 3) {
+		std::cerr << "Incorrect arguments\n" << usage << std::endl;
+		exit(EXIT_FAILURE);
+	}
+	bool ssaMode = false;
+	std::string profileFile;
+	std::vector<std::string> revisions;
+	int memLatency = -1;
+	bool portfolioMode = false;
+	double portfolioThreshold = -1;
+	int threadCount = 0;
+	bool threeAddress = false;
+	bool cleanup = false;
+	int sweepMin = -1;
+	int sweepMax = -1;
+	long budgetMicros = -1;
+	for (int i = 3; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--ssa") {
+			ssaMode = true;
+		}
+		else if (arg == "--profile" && i + 1 < argc) {
+			profileFile = argv[++i];
+		}
+		else if (arg == "--incremental" && i + 1 < argc) {
+			revisions.push_back(argv[++i]);
+		}
+		else if (arg == "--portfolio") {
+			portfolioMode = true;
+		}
+		else if (arg == "--portfolio-threshold" && i + 1 < argc) {
+			portfolioMode = true;
+			portfolioThreshold = atof(argv[++i]);
+		}
+		else if (arg == "--three-address") {
+			threeAddress = true;
+		}
+		else if (arg == "--cleanup") {
+			cleanup = true;
+		}
+		else if (arg == "--sweep" && i + 2 < argc) {
+			sweepMin = atoi(argv[++i]);
+			sweepMax = atoi(argv[++i]);
+			if (sweepMin < 1 || sweepMax < sweepMin) {
+				std::cerr << "Sweep range must satisfy 1 <= min <= max\n" << usage << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if (arg == "--budget" && i + 1 < argc) {
+			budgetMicros = atol(argv[++i]);
+			if (budgetMicros < 0) {
+				std::cerr << "Budget must be >= 0\n" << usage << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if (arg == "--threads" && i + 1 < argc) {
+			threadCount = atoi(argv[++i]);
+		}
+		else if (arg == "--interpret" && i + 1 < argc) {
+			memLatency = atoi(argv[++i]);
+			if (memLatency < 0) {
+				std::cerr << "Memory latency must be >= 0\n" << usage << std::endl;
+				exit(EXIT_FAILURE);
+			}
+		}
+		else {
+			std::cerr << "Unknown option " << arg << "\n" << usage << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	std::string src_code = readf(argv[1]);
+	std::string inFileName = std::string(argv[1]);
+	int registerCount = atoi(argv[2]);
+	AstNode* root = parseProgram(src_code);
 	std::ofstream astFile;
 	astFile.open(inFileName + "_ast.mmd", std::ios::trunc);
 	outputTree(root, 0, astFile);
 	astFile.close();
+	// everything below works on main's top level statements
+	std::vector<Function> functions = splitFunctions(root);
+	if (cleanup) {
+		// constants and dead stores never reach the allocators
+		CleanupPass cleanupPass;
+		cleanupPass.run(root, true);
+		for (auto& function : functions) {
+			cleanupPass.run(function.body);
+		}
+		std::cout << "Cleanup: " << cleanupPass.getPropagated() << " constant uses propagated, "
+				  << cleanupPass.getFolded() << " expressions folded, "
+				  << cleanupPass.getRemovedStatements() << " statements removed, "
+				  << cleanupPass.getRemovedVariables() << " variables removed ("
+				  << cleanupPass.getDeadStoreRounds() << " dead-store rounds)" << std::endl;
+	}
+	if (threeAddress) {
+		// one operation per statement, temporaries named for the allocators
+		ThreeAddressLowering lowering;
+		lowering.lower(root);
+		for (auto& function : functions) {
+			lowering.lower(function.body);
+		}
+		std::cout << "Three-address lowering: " << lowering.getTempCount() << " temporaries, at most "
+				  << lowering.getPeakTemps() << " live per statement (left to right: " 
+				  << lowering.getPeakTempsInOrder() << ")" << std::endl;
+	}
 	
 	CFGCreator cfgCreator;
 	cfgCreator.genCFG(root);
 	cfgCreator.outputCFG(inFileName + "_cfg.mmd");
 
-	LiveOut liveout(cfgCreator.getCFGBlocks());
+	LiveOut liveout(cfgCreator.getCFG());
 	liveout.prepCFG();
 	liveout.computeLiveOut();
-
-	GraphColoring graphColoring(registerCount);
-	graphColoring.createGraph(cfgCreator.getCFGBlocks());
-	graphColoring.colorGraph();
+	std::cout << std::endl;
 
 	IRManager irman;
 	std::ofstream irFile;
 	irFile.open(inFileName + "_ir.txt");
 	irman.generateIR(root, irFile);
 
-	std::cout << std::endl;
+	// constant valued variables are cheap to spill, just re-emit the constant
+	auto rematVars = findRematerializable(root, cfgCreator.getCFG());
+	SpillCost spillCost(rematVars);
+	if (!profileFile.empty()) {
+		// weight every def/use by how often its block actually ran
+		Profile profile;
+		std::string error;
+		if (!profile.load(profileFile, error)) {
+			std::cerr << error << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		auto blockFreq = profile.blockFrequencies(cfgCreator.getCFG(), irman.getIrLineNodes());
+		spillCost.computeCosts(cfgCreator.getCFG(), blockFreq);
+	}
+	else {
+		spillCost.computeCosts(cfgCreator.getCFG());
+	}
+
+	// the portfolio, the sweep and the budget run their own allocators, the
+	// single runs are only needed when a report below is built on them
+	bool ownAllocators = portfolioMode || sweepMin > 0 || budgetMicros >= 0;
+	bool singleRuns = !ownAllocators || !profileFile.empty() || memLatency >= 0 || ssaMode;
+	auto start = std::chrono::steady_clock::now();
+	GraphColoring graphColoring(registerCount);
 	LinearScan linearScan(registerCount);
-	linearScan.computeIntervals(irman.getIrVarData());
-	linearScan.allocateRegisters();
+	long graphColoringTime = 0;
+	long linearScanTime = 0;
+	if (singleRuns) {
+		graphColoring.setSpillCost(spillCost);
+		graphColoring.createGraph(cfgCreator.getCFG());
+		graphColoring.colorGraph();
+		graphColoringTime = elapsedMicros(start);
 
-}
+		std::cout << std::endl;
+		start = std::chrono::steady_clock::now();
+		linearScan.setSpillCost(spillCost);
+		linearScan.computeIntervals(cfgCreator.getCFG());
+		linearScan.allocateRegisters();
+		linearScanTime = elapsedMicros(start);
+	}
 
+	if (!profileFile.empty()) {
+		// rerun without the profile, measure both with the profiled counts
+		SpillCost unprofiledCost(rematVars);
+		unprofiledCost.computeCosts(cfgCreator.getCFG());
 
+		GraphColoring unprofiledColoring(registerCount);
+		unprofiledColoring.setVerbose(false);
+		unprofiledColoring.setSpillCost(unprofiledCost);
+		unprofiledColoring.createGraph(cfgCreator.getCFG());
+		unprofiledColoring.colorGraph();
+
+		LinearScan unprofiledScan(registerCount);
+		unprofiledScan.setVerbose(false);
+		unprofiledScan.setSpillCost(unprofiledCost);
+		unprofiledScan.computeIntervals(cfgCreator.getCFG());
+		unprofiledScan.allocateRegisters();
+
+		std::cout << std::endl << "Profiled Dynamic Spill Traffic:" << std::endl;
+		printTrafficSaved("GraphColoring", 
+			spillCost.spillTraffic(unprofiledColoring.getRegMap()), 
+			spillCost.spillTraffic(graphColoring.getRegMap()));
+		printTrafficSaved("LinearScan", 
+			spillCost.spillTraffic([&](const std::string& var, int pos) {return unprofiledScan.locate(var, pos);}), 
+			spillCost.spillTraffic([&](const std::string& var, int pos) {return linearScan.locate(var, pos);}));
+	}
+
+	if (portfolioMode) {
+		// every allocator on its own thread over the shared analysis,
+		// the lowest weighted spill cost wins
+		GraphColoring portfolioColoring(registerCount);
+		LinearScan portfolioScan(registerCount);
+		Portfolio portfolio(portfolioThreshold);
+		portfolio.addStrategy("GraphColoring", [&](const std::atomic<bool>& cancel, double& score) {
+			portfolioColoring.setVerbose(false);
+			portfolioColoring.setSpillCost(spillCost);
+			portfolioColoring.setCancelFlag(cancel);
+			portfolioColoring.createGraph(cfgCreator.getCFG());
+			portfolioColoring.colorGraph();
+			auto traffic = spillCost.spillTraffic(portfolioColoring.getRegMap());
+			score = traffic.first + traffic.second;
+			return !portfolioColoring.wasCancelled();
+		});
+		portfolio.addStrategy("LinearScan", [&](const std::atomic<bool>& cancel, double& score) {
+			portfolioScan.setVerbose(false);
+			portfolioScan.setSpillCost(spillCost);
+			portfolioScan.setCancelFlag(cancel);
+			portfolioScan.computeIntervals(cfgCreator.getCFG());
+			portfolioScan.allocateRegisters();
+			auto traffic = spillCost.spillTraffic(
+				[&](const std::string& var, int pos) {return portfolioScan.locate(var, pos);});
+			score = traffic.first + traffic.second;
+			return !portfolioScan.cancelled;
+		});
+
+		start = std::chrono::steady_clock::now();
+		int best = portfolio.run();
+		long portfolioTime = elapsedMicros(start);
+
+		std::cout << std::endl;
+		portfolio.printResults();
+		std::cout << "Portfolio: " << portfolioTime << "us" << std::endl;
+		if (best == 0) {
+			portfolioColoring.printResults();
+		}
+		else if (best == 1) {
+			portfolioScan.printResults();
+		}
+	}
 
+	if (sweepMin > 0) {
+		// one analysis, allocated for every register count in the range
+		RegisterSweep sweep(cfgCreator.getCFG(), spillCost);
+		sweep.run(sweepMin, sweepMax, threadCount);
+		std::cout << std::endl;
+		sweep.printResults();
+	}
+
+	if (budgetMicros >= 0) {
+		// linear scan always, graph coloring only if it makes the deadline
+		TieredAllocator tiered(registerCount, budgetMicros);
+		tiered.setSpillCost(spillCost);
+		tiered.allocate(cfgCreator.getCFG());
+		std::cout << std::endl;
+		tiered.printResults();
+	}
+
+	if (memLatency >= 0) {
+		// run the ir on both allocations, counting what the spills cost
+		Interpreter interpreter(irman.getIrInsts(), cfgCreator.getCFG(), registerCount, memLatency);
+		interpreter.setSpillCost(spillCost);
+		std::cout << std::endl << "Execution (memory latency " << memLatency << "):" << std::endl;
+		printExecStats("GraphColoring", interpreter.run(graphColoring.getRegMap()));
+		printExecStats("LinearScan", interpreter.run(
+			[&](const std::string& var, int pos) {return linearScan.locate(var, pos);}));
+	}
+
+	if (ssaMode) {
+		// ssa construction plus chordal coloring, benchmarked against the others
+		std::cout << std::endl;
+		start = std::chrono::steady_clock::now();
+		SSAForm ssa(cfgCreator.getCFG());
+		ssa.build();
+		ChordalColoring chordalColoring(ssa, registerCount);
+		chordalColoring.setSpillCost(spillCost);
+		chordalColoring.allocateRegisters();
+		long chordalTime = elapsedMicros(start);
+		int copies = chordalColoring.outputParallelCopies();
+
+		std::cout << std::endl;
+		ssa.outputSSA(std::cout);
+		std::cout << "Benchmark (" << registerCount << " registers):" << std::endl;
+		std::cout << "GraphColoring: " << graphColoringTime << "us, " 
+				  << graphColoring.getSpillCount() << " spills" << std::endl;
+		std::cout << "LinearScan: " << linearScanTime << "us, " 
+				  << linearScan.getSpillCount() << " spills" << std::endl;
+		std::cout << "SSA Chordal: " << chordalTime << "us, " 
+				  << chordalColoring.getSpillCount() << " spills, "
+				  << ssa.phiCount() << " phis, " 
+				  << copies << " parallel copies" << std::endl;
+	}
+
+	if (!revisions.empty()) {
+		// edited versions of the program, each patched onto the last analysis
+		IncrementalAllocator incremental(registerCount);
+		incremental.fullRun(root);
+		for (auto& revision : revisions) {
+			AstNode* revisionRoot = parseProgram(readf(revision));
+			splitFunctions(revisionRoot);
+			if (cleanup) {
+				CleanupPass().run(revisionRoot, true);
+			}
+			if (threeAddress) {
+				ThreeAddressLowering().lower(revisionRoot);
+			}
+			start = std::chrono::steady_clock::now();
+			bool patched = incremental.update(revisionRoot);
+			long updateTime = elapsedMicros(start);
+
+			// reference latency, the same revision from scratch
+			IncrementalAllocator scratch(registerCount);
+			start = std::chrono::steady_clock::now();
+			scratch.fullRun(revisionRoot);
+			long fullTime = elapsedMicros(start);
+
+			std::cout << std::endl << "Revision " << revision << ": " 
+					  << (patched ? "incremental" : "full run") << ", "
+					  << incremental.getChangedStatements() << " changed statements, "
+					  << incremental.getReanalyzedBlocks() << " blocks re-analyzed, "
+					  << incremental.getRecolored() << " recolored, "
+					  << updateTime << "us (from scratch " << fullTime << "us), "
+					  << incremental.countConflicts() << " conflicts with a full graph" << std::endl;
+			incremental.printResults();
+		}
+	}
+
+	if (!functions.empty()) {
+		// each function analyzed and allocated on its own, in parallel
+		functions.insert(functions.begin(), Function{"main", {}, root});
+		FunctionAllocator functionAllocator(registerCount);
+		functionAllocator.allocateAll(functions, threadCount);
+		std::cout << std::endl;
+		functionAllocator.printResults();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#include "portfolio.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+void Portfolio::addStrategy(const std::string& name, allocStrategy strategy){
+    strategies.push_back(std::make_pair(name, strategy));
+}
+
+int Portfolio::run(){
+    std::atomic<bool> cancel(false);
+    results = std::vector<StrategyResult>(strategies.size());
+    std::vector<std::thread> workers;
+    for(int i = 0; i < strategies.size(); ++i){
+        workers.emplace_back([&, i](){
+            // each thread only writes its own slot
+            auto start = std::chrono::steady_clock::now();
+            auto& result = results[i];
+            result.name = strategies[i].first;
+            result.cancelled = !strategies[i].second(cancel, result.score);
+            result.micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            if(!result.cancelled && threshold >= 0 && result.score <= threshold){
+                cancel.store(true);
+            }
+        });
+    }
+    for(auto& worker : workers){
+        worker.join();
+    }
+
+    best = -1;
+    for(int i = 0; i < results.size(); ++i){
+        if(results[i].cancelled){
+            continue;
+        }
+        if(best == -1 || results[i].score < results[best].score
+            || (results[i].score == results[best].score && results[i].micros < results[best].micros)){
+            best = i;
+        }
+    }
+    return best;
+}
+
+void Portfolio::printResults(){
+    std::cout << "Portfolio Results:" << std::endl;
+    for(int i = 0; i < results.size(); ++i){
+        auto& result = results[i];
+        std::cout << result.name << ": " << result.micros << "us, ";
+        if(result.cancelled){
+            std::cout << "cancelled" << std::endl;
+            continue;
+        }
+        std::cout << "spill cost " << result.score << (i == best ? " (best)" : "") << std::endl;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+// one allocation strategy, allocates into state it owns and sets score to
+// the weighted spill cost of its result, false when it saw cancel and stopped
+typedef std::function<bool(const std::atomic<bool>& cancel, double& score)> allocStrategy;
+
+struct StrategyResult{
+    std::string name;
+    double score = 0;
+    long micros = 0;
+    bool cancelled = false;
+};
+
+// runs every strategy on its own thread over the same read-only analysis
+// and keeps the lowest spill cost
+class Portfolio{
+    private:
+        std::vector<std::pair<std::string, allocStrategy>> strategies;
+        // a result at or below this cost cancels the strategies still
+        // running, negative never cancels
+        double threshold;
+        std::vector<StrategyResult> results;
+        int best = -1;
+    public:
+        Portfolio(double threshold = -1): threshold(threshold) {};
+
+        void addStrategy(const std::string& name, allocStrategy strategy);
+        // index of the best finished strategy, -1 if none finished
+        int run();
+        const std::vector<StrategyResult>& getResults() {return results;};
+        int getBest() {return best;};
+        void printResults();
+};
@@ -0,0 +1,52 @@
+#include "profile.h"
+#include <fstream>
+#include <sstream>
+
+bool Profile::load(const std::string& filename, std::string& error){
+    std::ifstream file(filename);
+    if(!file.is_open()){
+        error = "cannot open profile " + filename;
+        return false;
+    }
+    std::string line;
+    int lineno = 0;
+    while(std::getline(file, line)){
+        lineno++;
+        std::istringstream fields(line);
+        std::string kind;
+        if(!(fields >> kind) || kind[0] == '#'){
+            continue;
+        }
+        int key;
+        double count;
+        if(!(fields >> key >> count) || (kind != "block" && kind != "line")){
+            error = filename + ":" + std::to_string(lineno) + ": expected 'block|line <id> <count>'";
+            return false;
+        }
+        auto& counts = kind == "block" ? blockCounts : lineCounts;
+        counts[key] += count;
+    }
+    return true;
+}
+
+std::vector<double> Profile::blockFrequencies(
+        CompactCFG& cfg, 
+        std::unordered_map<int, AstNode*>& irLineNodes){
+    std::unordered_map<AstNode*, int> nodeBlock;
+    std::vector<double> freq(cfg.size(), 0);
+    for(int id = 0; id < cfg.size(); ++id){
+        freq[id] = blockCounts.count(id) ? blockCounts[id] : 0;
+        if(cfg.blocks[id].astNode){
+            nodeBlock[cfg.blocks[id].astNode] = id;
+        }
+    }
+    for(auto elem : lineCounts){
+        // label and goto lines have no block
+        if(!irLineNodes.count(elem.first)) {continue;}
+        auto* node = irLineNodes[elem.first];
+        if(nodeBlock.count(node)){
+            freq[nodeBlock[node]] += elem.second;
+        }
+    }
+    return freq;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include "cfg.h"
+
+// execution counts, one entry per line of the profile file:
+//   block <cfg block id> <count>
+//   line <ir line> <count>
+// blank lines and lines starting with # are skipped
+class Profile{
+    private:
+        std::unordered_map<int, double> blockCounts;
+        std::unordered_map<int, double> lineCounts;
+    public:
+        // false with a message on malformed input
+        bool load(const std::string& filename, std::string& error);
+
+        // execution count of every cfg block, ir lines are matched to the
+        // block holding the same statement, unlisted blocks never ran
+        std::vector<double> blockFrequencies(
+            CompactCFG& cfg, 
+            std::unordered_map<int, AstNode*>& irLineNodes);
+};
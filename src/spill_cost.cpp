@@ -0,0 +1,128 @@
+#include "spill_cost.h"
+#include "liveout.h"
+
+// walk every VARDECL, a variable stays a candidate while all its rhs are the same NUM
+static void collectDefs(AstNode* node, 
+                        std::unordered_map<std::string, std::string>& constDefs,
+                        std::unordered_set<std::string>& notConst){
+    if(node->type == NodeType::VARDECL){
+        auto var = node->children.at(0)->value;
+        auto* rhs = node->children.at(1);
+        if(rhs->type != NodeType::NUM){
+            notConst.insert(var);
+        }
+        else if(constDefs.count(var) && constDefs[var] != rhs->value){
+            // two different constants can reach a use
+            notConst.insert(var);
+        }
+        else{
+            constDefs[var] = rhs->value;
+        }
+    }
+    for(auto* child : node->children){
+        collectDefs(child, constDefs, notConst);
+    }
+}
+
+std::unordered_map<std::string, std::string> findRematerializable(AstNode* root, const CompactCFG& cfg, 
+                                                                  const std::vector<std::string>& params){
+    std::unordered_map<std::string, std::string> constDefs;
+    std::unordered_set<std::string> notConst;
+    collectDefs(root, constDefs, notConst);
+    // a value read before its first def or passed in cannot be rebuilt from the constant
+    notConst.insert(cfg.blocks.at(0).liveout.begin(), cfg.blocks.at(0).liveout.end());
+    notConst.insert(params.begin(), params.end());
+    for(auto v : notConst){
+        constDefs.erase(v);
+    }
+    return constDefs;
+}
+
+void SpillCost::computeCosts(CompactCFG& cfg){
+    computeCosts(cfg, std::vector<double>(cfg.size(), 1));
+}
+
+void SpillCost::computeCosts(CompactCFG& cfg, const std::vector<double>& blockFreq){
+    for(int id = 0; id < cfg.size(); ++id){
+        auto* astNode = cfg.blocks[id].astNode;
+        if(!astNode) {continue;}
+        double freq = blockFreq.at(id);
+        if(astNode->type == NodeType::VARDECL){
+            stores[astNode->children.at(0)->value][id] += freq;
+            for(auto u : getUEVar(astNode->children.at(1))){
+                loads[u][id] += freq;
+            }
+        }
+        else if(astNode->type == NodeType::IF || astNode->type == NodeType::WHILE
+            || astNode->type == NodeType::RETURN){
+            for(auto u : getUEVar(astNode->children.at(0))){
+                loads[u][id] += freq;
+            }
+        }
+    }
+    for(auto elem : stores){
+        for(auto block : elem.second){
+            costs[elem.first] += block.second;
+        }
+    }
+    for(auto elem : loads){
+        for(auto block : elem.second){
+            costs[elem.first] += block.second;
+        }
+    }
+}
+
+double SpillCost::getCost(const std::string& var) const{
+    if(isRemat(var)){
+        return rematCost;
+    }
+    auto it = costs.find(var);
+    return it == costs.end() ? 0 : it->second;
+}
+
+double SpillCost::getRangeCost(const std::string& var, int start, int end) const{
+    if(isRemat(var)){
+        return rematCost;
+    }
+    double cost = 0;
+    if(loads.count(var)){
+        for(auto block : loads.at(var)){
+            int pos = 2 * block.first;
+            cost += pos >= start && pos <= end ? block.second : 0;
+        }
+    }
+    if(stores.count(var)){
+        for(auto block : stores.at(var)){
+            int pos = 2 * block.first + 1;
+            cost += pos >= start && pos <= end ? block.second : 0;
+        }
+    }
+    return cost;
+}
+
+std::pair<double, double> SpillCost::spillTraffic(const std::unordered_map<std::string, int>& regMap) const{
+    return spillTraffic([&](const std::string& var, int position){
+        // a variable the allocator never placed is not a spill, only -1 is compared
+        auto it = regMap.find(var);
+        return it == regMap.end() ? 0 : it->second;
+    });
+}
+
+std::pair<double, double> SpillCost::spillTraffic(locateFn locate) const{
+    double spillLoads = 0;
+    double spillStores = 0;
+    for(auto elem : loads){
+        // rematerialized constants never touch memory
+        if(isRemat(elem.first)) {continue;}
+        for(auto block : elem.second){
+            spillLoads += locate(elem.first, 2 * block.first) == -1 ? block.second : 0;
+        }
+    }
+    for(auto elem : stores){
+        if(isRemat(elem.first)) {continue;}
+        for(auto block : elem.second){
+            spillStores += locate(elem.first, 2 * block.first + 1) == -1 ? block.second : 0;
+        }
+    }
+    return std::make_pair(spillLoads, spillStores);
+}
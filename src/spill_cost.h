@@ -0,0 +1,42 @@
+#pragma once
+#include "cfg.h"
+#include <functional>
+
+// register of a variable at a linear position, 2*block reads the block's
+// uses and 2*block+1 holds its def, -1 when the variable is in memory
+typedef std::function<int(const std::string&, int)> locateFn;
+
+// variables whose every definition is the same NUM literal, mapped to that literal;
+// values arriving from outside (live out of START, parameters) never qualify
+std::unordered_map<std::string, std::string> findRematerializable(AstNode* root, const CompactCFG& cfg, 
+                                                                  const std::vector<std::string>& params = {});
+
+class SpillCost{
+    private:
+        std::unordered_map<std::string, double> costs;
+        // weighted defs and uses per block, what a spill turns into stores and loads
+        std::unordered_map<std::string, std::unordered_map<int, double>> stores;
+        std::unordered_map<std::string, std::unordered_map<int, double>> loads;
+        std::unordered_map<std::string, std::string> remat;
+    public:
+        // reloading a constant is one immediate move, no memory traffic
+        static constexpr double rematCost = 0.01;
+
+        SpillCost() {};
+        SpillCost(std::unordered_map<std::string, std::string> rematVars): remat(rematVars) {};
+
+        // one unit of cost for every def/use of a variable in the cfg
+        void computeCosts(CompactCFG& cfg);
+        // same, with every def/use weighted by its block's execution count
+        void computeCosts(CompactCFG& cfg, const std::vector<double>& blockFreq);
+        // <loads, stores> executed if the spilled variables of regMap live in memory,
+        // variables missing from regMap are not counted
+        std::pair<double, double> spillTraffic(const std::unordered_map<std::string, int>& regMap) const;
+        // same for allocations whose location changes along the program
+        std::pair<double, double> spillTraffic(locateFn locate) const;
+        double getCost(const std::string& var) const;
+        // cost of the defs/uses between two linear positions
+        double getRangeCost(const std::string& var, int start, int end) const;
+        bool isRemat(const std::string& var) const {return remat.count(var);};
+        const std::string& getConstant(const std::string& var) const {return remat.at(var);};
+};
@@ -0,0 +1,253 @@
+#include "ssa.h"
+#include "liveout.h"
+
+std::vector<int> SSAForm::reversePostorder(){
+    std::vector<int> postorder;
+    std::vector<bool> visited(cfg.size(), false);
+    // iterative dfs, straight line programs give very deep cfgs
+    std::vector<std::pair<int, int>> work = {{0, 0}};
+    visited[0] = true;
+    while(!work.empty()){
+        auto& top = work.back();
+        auto children = cfg.successors(top.first);
+        if(top.second < children.size()){
+            int child = children.first[top.second++];
+            if(!visited[child]){
+                visited[child] = true;
+                work.push_back({child, 0});
+            }
+            continue;
+        }
+        postorder.push_back(top.first);
+        work.pop_back();
+    }
+    return std::vector<int>(postorder.rbegin(), postorder.rend());
+}
+
+// Cooper, Harvey, Kennedy: A Simple, Fast Dominance Algorithm
+void SSAForm::computeDominators(){
+    int n = cfg.size();
+    idom.assign(n, -1);
+    domChildren.assign(n, {});
+    auto order = reversePostorder();
+    std::vector<int> rpoIndex(n, -1);
+    for(int i = 0; i < order.size(); ++i){
+        rpoIndex[order[i]] = i;
+    }
+
+    auto intersect = [&](int a, int b){
+        while(a != b){
+            while(rpoIndex[a] > rpoIndex[b]) {a = idom[a];}
+            while(rpoIndex[b] > rpoIndex[a]) {b = idom[b];}
+        }
+        return a;
+    };
+
+    idom[0] = 0;
+    bool changed = true;
+    while(changed){
+        changed = false;
+        for(auto b : order){
+            if(b == 0) {continue;}
+            int newIdom = -1;
+            for(auto p : cfg.predecessors(b)){
+                if(idom[p] == -1) {continue;}
+                newIdom = newIdom == -1 ? p : intersect(p, newIdom);
+            }
+            if(newIdom != idom[b]){
+                idom[b] = newIdom;
+                changed = true;
+            }
+        }
+    }
+    for(int b = 1; b < n; ++b){
+        if(idom[b] != -1){
+            domChildren[idom[b]].push_back(b);
+        }
+    }
+}
+
+void SSAForm::computeFrontiers(){
+    frontier.assign(cfg.size(), {});
+    for(int b = 0; b < cfg.size(); ++b){
+        auto parents = cfg.predecessors(b);
+        if(parents.size() < 2 || idom[b] == -1) {continue;}
+        for(auto p : parents){
+            int runner = p;
+            while(idom[runner] != -1 && runner != idom[b]){
+                frontier[runner].insert(b);
+                runner = idom[runner];
+            }
+        }
+    }
+}
+
+static bool isLiveIn(const CFGNode& node, const std::string& var){
+    return node.uevar.count(var) || (node.liveout.count(var) && !node.varkill.count(var));
+}
+
+void SSAForm::placePhis(){
+    // blocks defining each variable
+    std::unordered_map<std::string, std::vector<int>> defsites;
+    for(int b = 0; b < cfg.size(); ++b){
+        auto* astNode = cfg.blocks[b].astNode;
+        if(astNode && astNode->type == NodeType::VARDECL){
+            defsites[astNode->children.at(0)->value].push_back(b);
+        }
+    }
+    for(auto elem : defsites){
+        auto var = elem.first;
+        std::vector<int> worklist = elem.second;
+        std::unordered_set<int> queued(worklist.begin(), worklist.end());
+        std::unordered_set<int> hasPhi;
+        while(!worklist.empty()){
+            int n = worklist.back();
+            worklist.pop_back();
+            for(auto d : frontier[n]){
+                // pruned: no phi where the variable is dead
+                if(hasPhi.count(d) || !isLiveIn(cfg.blocks[d], var)) {continue;}
+                PhiNode phi;
+                phi.var = var;
+                ssaBlocks[d].phis.push_back(phi);
+                hasPhi.insert(d);
+                if(!queued.count(d)){
+                    queued.insert(d);
+                    worklist.push_back(d);
+                }
+            }
+        }
+    }
+}
+
+std::string SSAForm::newName(const std::string& var){
+    std::string name = var + "." + std::to_string(++versions[var]);
+    nameStack[var].push_back(name);
+    ssaToVar[name] = var;
+    return name;
+}
+
+std::string SSAForm::currentName(const std::string& var){
+    if(nameStack[var].empty()){
+        // read before any definition
+        std::string name = var + ".0";
+        entryNames.insert(name);
+        ssaToVar[name] = var;
+        return name;
+    }
+    return nameStack[var].back();
+}
+
+void SSAForm::rename(){
+    // walk the dominator tree, popping names on the way back up
+    std::vector<std::vector<std::string>> pushed(cfg.size());
+    std::vector<std::pair<int, bool>> work = {{0, false}};
+    while(!work.empty()){
+        auto [b, exiting] = work.back();
+        work.pop_back();
+        if(exiting){
+            for(auto v : pushed[b]){
+                nameStack[v].pop_back();
+            }
+            continue;
+        }
+        work.push_back({b, true});
+
+        auto& block = ssaBlocks[b];
+        for(auto& phi : block.phis){
+            phi.dest = newName(phi.var);
+            pushed[b].push_back(phi.var);
+        }
+        auto* astNode = cfg.blocks[b].astNode;
+        if(astNode && astNode->type == NodeType::VARDECL){
+            for(auto u : getUEVar(astNode->children.at(1))){
+                block.uses[u] = currentName(u);
+            }
+            auto var = astNode->children.at(0)->value;
+            block.def = newName(var);
+            pushed[b].push_back(var);
+        }
+        else if(astNode && (astNode->type == NodeType::IF || astNode->type == NodeType::WHILE
+            || astNode->type == NodeType::RETURN)){
+            for(auto u : getUEVar(astNode->children.at(0))){
+                block.uses[u] = currentName(u);
+            }
+        }
+
+        for(auto child : cfg.successors(b)){
+            for(auto& phi : ssaBlocks[child].phis){
+                phi.sources[b] = currentName(phi.var);
+            }
+        }
+        auto& domKids = domChildren[b];
+        for(auto it = domKids.rbegin(); it != domKids.rend(); ++it){
+            work.push_back({*it, false});
+        }
+    }
+}
+
+void SSAForm::build(){
+    ssaBlocks.assign(cfg.size(), SSABlock());
+    computeDominators();
+    computeFrontiers();
+    placePhis();
+    rename();
+}
+
+int SSAForm::phiCount(){
+    int count = 0;
+    for(auto& block : ssaBlocks){
+        count += block.phis.size();
+    }
+    return count;
+}
+
+// print an expression with variables replaced by their ssa names
+static std::string ssaString(AstNode* node, std::unordered_map<std::string, std::string>& uses){
+    switch(node->type){
+        case NodeType::VAR:
+            return uses.count(node->value) ? uses.at(node->value) : node->value;
+        case NodeType::OP:
+        case NodeType::CMPOP:
+            return ssaString(node->children.at(0), uses) 
+                    + " " 
+                    + node->value 
+                    + " " 
+                    + ssaString(node->children.at(1), uses);
+        case NodeType::CALL:{
+            std::string str = node->value + "(";
+            for(int i = 0; i < node->children.size(); ++i){
+                str += (i ? ", " : "") + ssaString(node->children[i], uses);
+            }
+            return str + ")";
+        }
+        default:
+            return node->toString();
+    }
+}
+
+void SSAForm::outputSSA(std::ostream& out){
+    out << "SSA Form:" << std::endl;
+    for(int b = 0; b < ssaBlocks.size(); ++b){
+        auto& block = ssaBlocks[b];
+        for(auto& phi : block.phis){
+            out << "(" << b << ") " << phi.dest << " = phi(";
+            bool first = true;
+            for(auto p : cfg.predecessors(b)){
+                out << (first ? "" : ", ") << phi.sources[p] << " [" << p << "]";
+                first = false;
+            }
+            out << ")" << std::endl;
+        }
+        auto* astNode = cfg.blocks[b].astNode;
+        if(!astNode) {continue;}
+        if(astNode->type == NodeType::VARDECL){
+            out << "(" << b << ") " << block.def << " = " 
+                << ssaString(astNode->children.at(1), block.uses) << std::endl;
+        }
+        else{
+            out << "(" << b << ") " << astNode->value << " (" 
+                << ssaString(astNode->children.at(0), block.uses) << ")" << std::endl;
+        }
+    }
+    out << std::endl;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "cfg.h"
+
+// phi at the top of a block, one source per cfg parent
+struct PhiNode{
+    std::string var;
+    std::string dest;
+    std::unordered_map<int, std::string> sources;
+};
+
+struct SSABlock{
+    std::vector<PhiNode> phis;
+    // original variable -> ssa name read by the statement
+    std::unordered_map<std::string, std::string> uses;
+    // ssa name written by the statement, empty if none
+    std::string def;
+};
+
+// pruned ssa over the cfg, needs liveout computed on the blocks
+class SSAForm{
+    private:
+        CompactCFG& cfg;
+        std::vector<int> idom;
+        std::vector<std::vector<int>> domChildren;
+        std::vector<std::unordered_set<int>> frontier;
+        std::vector<SSABlock> ssaBlocks;
+
+        // renaming state
+        std::unordered_map<std::string, int> versions;
+        std::unordered_map<std::string, std::vector<std::string>> nameStack;
+        std::unordered_map<std::string, std::string> ssaToVar;
+        // ssa names read before any definition, live from the start block
+        std::unordered_set<std::string> entryNames;
+
+        std::vector<int> reversePostorder();
+        void computeDominators();
+        void computeFrontiers();
+        void placePhis();
+        std::string newName(const std::string& var);
+        std::string currentName(const std::string& var);
+        void rename();
+    public:
+        SSAForm(CompactCFG& cfg): cfg(cfg) {};
+
+        void build();
+        int size() {return ssaBlocks.size();};
+        SSABlock& getBlock(int id) {return ssaBlocks.at(id);};
+        CompactCFG& getCFG() {return cfg;};
+        int getIdom(int id) {return idom.at(id);};
+        std::vector<int>& getDomChildren(int id) {return domChildren.at(id);};
+        std::unordered_set<std::string>& getEntryNames() {return entryNames;};
+        const std::string& getVar(const std::string& ssaName) {return ssaToVar.at(ssaName);};
+        int phiCount();
+        void outputSSA(std::ostream& out);
+};
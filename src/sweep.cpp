@@ -0,0 +1,58 @@
+#include "sweep.h"
+#include "thread_pool.h"
+#include <chrono>
+
+void RegisterSweep::run(int minRegisters, int maxRegisters, int threads){
+    auto start = std::chrono::steady_clock::now();
+    // nothing here depends on the register count
+    GraphColoring baseColoring(minRegisters);
+    baseColoring.setVerbose(false);
+    baseColoring.setSpillCost(spillCost);
+    baseColoring.createGraph(cfg);
+    LinearScan baseScan(minRegisters);
+    baseScan.setVerbose(false);
+    baseScan.setSpillCost(spillCost);
+    baseScan.computeIntervals(cfg);
+    analysisMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    points.assign(maxRegisters - minRegisters + 1, SweepPoint());
+    ThreadPool pool(threads);
+    threadCount = pool.size();
+    for(int i = 0; i < points.size(); ++i){
+        // each task copies the shared analysis and only writes its own slot
+        pool.submit([this, &baseColoring, &baseScan, i, minRegisters](){
+            auto& point = points[i];
+            point.registers = minRegisters + i;
+
+            GraphColoring coloring(baseColoring);
+            coloring.setRegisters(point.registers);
+            coloring.colorGraph();
+            auto traffic = spillCost.spillTraffic(coloring.getRegMap());
+            point.coloringSpills = coloring.getSpillCount();
+            point.coloringCost = traffic.first + traffic.second;
+
+            LinearScan scan(baseScan);
+            scan.maxRegisters = point.registers;
+            scan.allocateRegisters();
+            traffic = spillCost.spillTraffic(
+                [&](const std::string& var, int pos) {return scan.locate(var, pos);});
+            point.scanSpills = scan.getSpillCount();
+            point.scanCost = traffic.first + traffic.second;
+        });
+    }
+    pool.wait();
+    wallMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void RegisterSweep::printResults(){
+    std::cout << "Register Sweep (k = " << points.front().registers << ".." << points.back().registers
+              << ", " << threadCount << " threads):" << std::endl;
+    for(auto& point : points){
+        std::cout << "k=" << point.registers << ": "
+                  << "GraphColoring " << point.coloringSpills << " spills, spill cost " << point.coloringCost << "; "
+                  << "LinearScan " << point.scanSpills << " spills, spill cost " << point.scanCost << std::endl;
+    }
+    std::cout << "Sweep: " << analysisMicros << "us analysis (once), " << wallMicros << "us total" << std::endl;
+}
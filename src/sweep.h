@@ -0,0 +1,35 @@
+#pragma once
+#include "graph_coloring.h"
+#include "linear_scan.h"
+
+// both allocators at one register count, cost is the weighted spill
+// traffic (dynamic spill loads + stores)
+struct SweepPoint{
+    int registers = 0;
+    int coloringSpills = 0;
+    double coloringCost = 0;
+    int scanSpills = 0;
+    double scanCost = 0;
+};
+
+// allocates one analysis for a range of register counts, the interference
+// graph and live intervals are built once and copied into every run
+class RegisterSweep{
+    private:
+        CompactCFG& cfg;
+        const SpillCost& spillCost;
+        std::vector<SweepPoint> points;
+        long analysisMicros = 0;
+        long wallMicros = 0;
+        int threadCount = 0;
+    public:
+        RegisterSweep(CompactCFG& cfg, const SpillCost& costs):
+            cfg(cfg),
+            spillCost(costs)
+            {};
+
+        // every k in [minRegisters, maxRegisters], 0 threads uses one per core
+        void run(int minRegisters, int maxRegisters, int threads);
+        void printResults();
+        std::vector<SweepPoint>& getPoints() {return points;};
+};
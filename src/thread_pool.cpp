@@ -0,0 +1,58 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threads){
+    if(threads <= 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for(int i = 0; i < threads; ++i){
+        workers.emplace_back([this](){ work(); });
+    }
+}
+
+ThreadPool::~ThreadPool(){
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    ready.notify_all();
+    for(auto& worker : workers){
+        worker.join();
+    }
+}
+
+void ThreadPool::work(){
+    while(true){
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.wait(guard, [this](){ return stopping || !tasks.empty(); });
+            if(tasks.empty()){
+                // stopping and drained
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+            running++;
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running--;
+        }
+        idle.notify_all();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task){
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        tasks.push(std::move(task));
+    }
+    ready.notify_one();
+}
+
+void ThreadPool::wait(){
+    std::unique_lock<std::mutex> guard(lock);
+    idle.wait(guard, [this](){ return tasks.empty() && running == 0; });
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads pulling tasks off a shared queue
+class ThreadPool{
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex lock;
+        std::condition_variable ready;
+        std::condition_variable idle;
+        int running = 0;
+        bool stopping = false;
+
+        void work();
+    public:
+        // 0 threads uses one per core
+        ThreadPool(int threads);
+        ~ThreadPool();
+
+        void submit(std::function<void()> task);
+        // blocks until every submitted task has finished
+        void wait();
+        int size() {return workers.size();};
+};
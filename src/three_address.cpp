@@ -0,0 +1,121 @@
+#include "three_address.h"
+#include <algorithm>
+
+static bool isLeaf(AstNode* node){
+    return node->type == NodeType::VAR || node->type == NodeType::NUM;
+}
+
+static AstNode* copyTree(AstNode* node){
+    AstNode* copy = new AstNode(node->value, node->type);
+    copy->isStatment = node->isStatment;
+    for(auto* child : node->children){
+        copy->adopt_child(copyTree(child));
+    }
+    return copy;
+}
+
+std::vector<int> ThreeAddressLowering::evalOrder(AstNode* node, bool inOrder, std::vector<int>& needs){
+    std::vector<int> order;
+    for(int i = 0; i < node->children.size(); ++i){
+        order.push_back(i);
+        needs.push_back(need(node->children[i], inOrder));
+    }
+    if(!inOrder){
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b){
+            return needs[a] > needs[b];
+        });
+    }
+    return order;
+}
+
+int ThreeAddressLowering::operandPeak(AstNode* node, bool inOrder){
+    // every operand already evaluated holds a temporary unless it is a leaf
+    int held = 0;
+    int peak = 0;
+    std::vector<int> needs;
+    for(auto i : evalOrder(node, inOrder, needs)){
+        peak = std::max(peak, held + needs[i]);
+        held += !isLeaf(node->children[i]);
+    }
+    return peak;
+}
+
+int ThreeAddressLowering::need(AstNode* node, bool inOrder){
+    if(isLeaf(node)){
+        return 0;
+    }
+    return std::max(1, operandPeak(node, inOrder));
+}
+
+void ThreeAddressLowering::countPressure(AstNode* expr){
+    if(isLeaf(expr)){
+        return;
+    }
+    peakTemps = std::max(peakTemps, operandPeak(expr, false));
+    peakTempsInOrder = std::max(peakTempsInOrder, operandPeak(expr, true));
+}
+
+AstNode* ThreeAddressLowering::lowerOperand(AstNode* node, std::vector<AstNode*>& out){
+    if(isLeaf(node)){
+        return node;
+    }
+    lowerTop(node, out);
+    std::string temp = "$t" + std::to_string(tempCount++);
+    AstNode* decl = new AstNode("=", NodeType::VARDECL);
+    decl->isStatment = true;
+    decl->adopt_child(new AstNode(temp, NodeType::VAR));
+    decl->adopt_child(node);
+    out.push_back(decl);
+    return new AstNode(temp, NodeType::VAR);
+}
+
+AstNode* ThreeAddressLowering::lowerTop(AstNode* node, std::vector<AstNode*>& out){
+    if(isLeaf(node)){
+        return node;
+    }
+    std::vector<int> needs;
+    for(auto i : evalOrder(node, false, needs)){
+        node->children[i] = lowerOperand(node->children[i], out);
+    }
+    return node;
+}
+
+void ThreeAddressLowering::lowerList(AstNode* list){
+    std::vector<AstNode*> lowered;
+    for(auto* stat : list->children){
+        // temporaries computed ahead of the statement
+        std::vector<AstNode*> pre;
+        if(stat->type == NodeType::VARDECL){
+            countPressure(stat->children.at(1));
+            lowerTop(stat->children.at(1), pre);
+        }
+        else if(stat->type == NodeType::RETURN){
+            countPressure(stat->children.at(0));
+            lowerTop(stat->children.at(0), pre);
+        }
+        else if(stat->type == NodeType::IF){
+            countPressure(stat->children.at(0));
+            lowerTop(stat->children.at(0), pre);
+            lowerList(stat->children.at(1));
+            if(stat->children.size() == 3){
+                lowerList(stat->children.at(2));
+            }
+        }
+        else if(stat->type == NodeType::WHILE){
+            countPressure(stat->children.at(0));
+            lowerTop(stat->children.at(0), pre);
+            lowerList(stat->children.at(1));
+            // the condition is evaluated again after every iteration
+            for(auto* decl : pre){
+                stat->children.at(1)->adopt_child(copyTree(decl));
+            }
+        }
+        lowered.insert(lowered.end(), pre.begin(), pre.end());
+        lowered.push_back(stat);
+    }
+    list->children = lowered;
+}
+
+void ThreeAddressLowering::lower(AstNode* root){
+    lowerList(root);
+}
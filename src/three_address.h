@@ -0,0 +1,32 @@
+#pragma once
+#include "ast.h"
+
+// rewrites statements so every expression is at most one operation on
+// variables/constants, intermediate results go to fresh temporaries
+// ($t0, $t1, ...) that the allocators then see like any other variable
+class ThreeAddressLowering{
+    private:
+        int tempCount = 0;
+        // most temporaries live at once inside one statement
+        int peakTemps = 0;
+        // same with operands always evaluated left to right
+        int peakTempsInOrder = 0;
+
+        // temporaries held at the peak while evaluating node's operands,
+        // operands with the larger need go first (Sethi-Ullman) unless inOrder
+        int operandPeak(AstNode* node, bool inOrder);
+        // operandPeak plus the temporary holding node's own result
+        int need(AstNode* node, bool inOrder);
+        // operand indices in evaluation order, fills in each operand's need
+        std::vector<int> evalOrder(AstNode* node, bool inOrder, std::vector<int>& needs);
+        void countPressure(AstNode* expr);
+        AstNode* lowerOperand(AstNode* node, std::vector<AstNode*>& out);
+        AstNode* lowerTop(AstNode* node, std::vector<AstNode*>& out);
+        void lowerList(AstNode* list);
+    public:
+        // lowers a ROOT or STAT_LIST in place
+        void lower(AstNode* root);
+        int getTempCount() {return tempCount;};
+        int getPeakTemps() {return peakTemps;};
+        int getPeakTempsInOrder() {return peakTempsInOrder;};
+};
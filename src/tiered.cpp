@@ -0,0 +1,106 @@
+#include "tiered.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+static long microsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void TieredAllocator::setSpillCost(const SpillCost& costs){
+    spillCost = &costs;
+    linearScan.setSpillCost(costs);
+    graphColoring.setSpillCost(costs);
+}
+
+void TieredAllocator::allocate(CompactCFG& cfg){
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::microseconds(budgetMicros);
+
+    // tier one, a valid allocation no matter how long it took
+    linearScan.setVerbose(false);
+    linearScan.computeIntervals(cfg);
+    linearScan.allocateRegisters();
+    scanMicros = microsSince(start);
+    if(std::chrono::steady_clock::now() >= deadline){
+        return;
+    }
+
+    // tier two races the deadline, the coloring loops poll the cancel flag
+    coloringStarted = true;
+    std::mutex lock;
+    std::condition_variable finished;
+    bool done = false;
+    auto coloringStart = std::chrono::steady_clock::now();
+    graphColoring.setVerbose(false);
+    graphColoring.setCancelFlag(cancel);
+    std::thread worker([&](){
+        graphColoring.createGraph(cfg);
+        graphColoring.colorGraph();
+        std::lock_guard<std::mutex> guard(lock);
+        done = true;
+        finished.notify_one();
+    });
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        if(!finished.wait_until(guard, deadline, [&](){return done;})){
+            cancel.store(true, std::memory_order_relaxed);
+        }
+    }
+    worker.join();
+    coloringMicros = microsSince(coloringStart);
+    // past the deadline the linear scan stands, even if the coloring
+    // finished before it saw the flag
+    if(cancel.load(std::memory_order_relaxed)){
+        overrunMicros = microsSince(deadline);
+        return;
+    }
+    tier = TIER_GRAPH_COLORING;
+}
+
+int TieredAllocator::locate(const std::string& var, int position){
+    if(tier == TIER_LINEAR_SCAN){
+        return linearScan.locate(var, position);
+    }
+    auto& regMap = graphColoring.getRegMap();
+    return regMap.count(var) ? regMap.at(var) : -1;
+}
+
+void TieredAllocator::printResults(){
+    std::cout << "Tiered Allocation (budget " << budgetMicros << "us):" << std::endl;
+    std::cout << "LinearScan tier: " << scanMicros << "us, " << linearScan.getSpillCount() << " spills";
+    if(spillCost){
+        auto traffic = spillCost->spillTraffic(
+            [&](const std::string& var, int pos) {return linearScan.locate(var, pos);});
+        std::cout << ", spill cost " << traffic.first + traffic.second;
+    }
+    std::cout << std::endl;
+
+    std::cout << "GraphColoring tier: ";
+    if(!coloringStarted){
+        std::cout << "skipped, budget used up by linear scan" << std::endl;
+    }
+    else if(tier == TIER_LINEAR_SCAN){
+        std::cout << "cancelled at the deadline after " << coloringMicros << "us ("
+                  << overrunMicros << "us past it)" << std::endl;
+    }
+    else{
+        std::cout << coloringMicros << "us, " << graphColoring.getSpillCount() << " spills";
+        if(spillCost){
+            auto traffic = spillCost->spillTraffic(graphColoring.getRegMap());
+            std::cout << ", spill cost " << traffic.first + traffic.second;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "Final allocation: " << (tier == TIER_GRAPH_COLORING ? "GraphColoring" : "LinearScan")
+              << " tier" << std::endl;
+    if(tier == TIER_GRAPH_COLORING){
+        graphColoring.printResults();
+    }
+    else{
+        linearScan.printResults();
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "graph_coloring.h"
+#include "linear_scan.h"
+
+enum AllocTier{
+    TIER_LINEAR_SCAN,
+    TIER_GRAPH_COLORING
+};
+
+// allocation under a hard time budget: linear scan first so there is always
+// a result, then graph coloring on a worker thread that is cancelled at the
+// deadline, its result replaces the linear scan only if it finished in time
+class TieredAllocator{
+    private:
+        long budgetMicros;
+        const SpillCost* spillCost = nullptr;
+        LinearScan linearScan;
+        GraphColoring graphColoring;
+        std::atomic<bool> cancel{false};
+        AllocTier tier = TIER_LINEAR_SCAN;
+        long scanMicros = 0;
+        long coloringMicros = 0;
+        // time from the deadline until the cancelled coloring returned
+        long overrunMicros = 0;
+        bool coloringStarted = false;
+    public:
+        TieredAllocator(int registers, long budget):
+            budgetMicros(budget),
+            linearScan(registers),
+            graphColoring(registers)
+            {};
+
+        void setSpillCost(const SpillCost& costs);
+        void allocate(CompactCFG& cfg);
+        void printResults();
+        AllocTier getTier() {return tier;};
+        // register holding var at a linear position in the final allocation, -1 in memory
+        int locate(const std::string& var, int position);
+};